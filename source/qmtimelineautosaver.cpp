@@ -0,0 +1,251 @@
+#include "qmtimelineautosaver.h"
+#include "qmtimelinebinary.h"
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinelog.h"
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtEndian>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace qmtl {
+
+namespace {
+constexpr int kDefaultCompressionLevel = 1;
+// 每次空闲时编码的payload数量，限制单次占用GUI线程的时间
+constexpr qsizetype kEncodeChunkItems = 256;
+
+struct SaveJob {
+    QmTimelineBinaryImage image;
+    quint64 revision { 0 };
+    QString file_path;
+    int compression_level { kDefaultCompressionLevel };
+};
+
+QString writeJob(const SaveJob& job)
+{
+    QByteArray data;
+    {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QDataStream stream(&buffer);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+        if (!QmTimelineBinaryFormat::writeImage(stream, job.image)) {
+            return QStringLiteral("Failed to encode the snapshot.");
+        }
+    }
+    if (job.compression_level != 0) {
+        data = qCompress(data, job.compression_level);
+    }
+
+    // QSaveFile先写入同目录下的临时文件，commit()时再替换目标文件
+    QSaveFile file(job.file_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return file.errorString();
+    }
+    if (file.write(data) != data.size() || !file.commit()) {
+        return file.errorString();
+    }
+    return {};
+}
+} // namespace
+
+struct QmTimelineAutosaverPrivate {
+    QmTimelineItemModel* model { nullptr };
+    QTimer timer;
+    // 收集快照之前在空闲时分批编码没有缓存的payload
+    QTimer encode_timer;
+    QString file_path;
+    int compression_level { kDefaultCompressionLevel };
+    // 最近一次交给保存线程的版本，没有新修改时不再保存；为空时下一次必须保存
+    std::optional<quint64> queued_revision;
+    quint64 saved_revision { 0 };
+    // 已交给保存线程、尚未完成的快照数，被替换的快照不计入
+    int outstanding_jobs { 0 };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // 等待写出的快照，保存线程忙时被更新的快照替换
+    std::optional<SaveJob> pending;
+    bool quit { false };
+};
+
+QmTimelineAutosaver::QmTimelineAutosaver(QmTimelineItemModel* model, QObject* parent)
+    : QObject(parent)
+    , d_(new QmTimelineAutosaverPrivate)
+{
+    d_->model = model;
+    d_->queued_revision = model->revision();
+    d_->saved_revision = model->revision();
+    connect(&d_->timer, &QTimer::timeout, this, &QmTimelineAutosaver::saveNow);
+    d_->encode_timer.setSingleShot(true);
+    d_->encode_timer.setInterval(0);
+    connect(&d_->encode_timer, &QTimer::timeout, this, &QmTimelineAutosaver::saveNow);
+    d_->thread = std::thread([this] { run(); });
+}
+
+QmTimelineAutosaver::~QmTimelineAutosaver() noexcept
+{
+    {
+        std::lock_guard lock(d_->mutex);
+        d_->quit = true;
+    }
+    d_->wake.notify_all();
+    // 正在写出的快照会写完，尚未开始的丢弃
+    d_->thread.join();
+    delete d_;
+}
+
+void QmTimelineAutosaver::setFilePath(const QString& file_path)
+{
+    if (file_path == d_->file_path) {
+        return;
+    }
+    d_->file_path = file_path;
+    // 新的文件需要完整保存一次
+    d_->queued_revision.reset();
+}
+
+QString QmTimelineAutosaver::filePath() const
+{
+    return d_->file_path;
+}
+
+void QmTimelineAutosaver::setInterval(int msec)
+{
+    if (msec > 0) {
+        d_->timer.start(msec);
+    } else {
+        d_->timer.stop();
+    }
+}
+
+int QmTimelineAutosaver::interval() const
+{
+    return d_->timer.isActive() ? d_->timer.interval() : 0;
+}
+
+void QmTimelineAutosaver::setCompressionLevel(int level)
+{
+    d_->compression_level = qBound(-1, level, 9);
+}
+
+int QmTimelineAutosaver::compressionLevel() const
+{
+    return d_->compression_level;
+}
+
+void QmTimelineAutosaver::saveNow()
+{
+    if (d_->file_path.isEmpty()) {
+        return;
+    }
+    quint64 revision = d_->model->revision();
+    if (revision == d_->queued_revision) {
+        return;
+    }
+    // 每次只编码一批，其余留到下一次事件循环，编码完成后才收集快照
+    if (!d_->model->encodePayloads(kEncodeChunkItems)) {
+        d_->encode_timer.start();
+        return;
+    }
+
+    SaveJob job { d_->model->binaryImage(), revision, d_->file_path, d_->compression_level };
+    bool replaced = false;
+    {
+        std::lock_guard lock(d_->mutex);
+        replaced = d_->pending.has_value();
+        d_->pending = std::move(job);
+    }
+    d_->wake.notify_one();
+    d_->queued_revision = revision;
+    if (!replaced) {
+        ++d_->outstanding_jobs;
+    }
+}
+
+bool QmTimelineAutosaver::isSaving() const
+{
+    return d_->outstanding_jobs > 0 || d_->encode_timer.isActive();
+}
+
+quint64 QmTimelineAutosaver::savedRevision() const
+{
+    return d_->saved_revision;
+}
+
+bool QmTimelineAutosaver::restore(QmTimelineItemModel* model, const QString& file_path)
+{
+    QFile file(file_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QMTL_LOG_ERROR("Failed to restore autosave. {}", file.errorString().toStdString());
+        return false;
+    }
+    QByteArray data = file.readAll();
+    // 未压缩的文件以快照的magic开头
+    if (data.size() < static_cast<qsizetype>(sizeof(quint32))
+        || qFromLittleEndian<quint32>(data.constData()) != QmTimelineBinaryFormat::kMagic) {
+        data = qUncompress(data);
+    }
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    if (!model->loadBinary(buffer)) {
+        return false;
+    }
+    model->resetDirty();
+    return true;
+}
+
+void QmTimelineAutosaver::run()
+{
+    while (true) {
+        SaveJob job;
+        {
+            std::unique_lock lock(d_->mutex);
+            d_->wake.wait(lock, [this] { return d_->quit || d_->pending.has_value(); });
+            if (d_->quit) {
+                return;
+            }
+            job = std::move(*d_->pending);
+            d_->pending.reset();
+        }
+
+        QString error_string = writeJob(job);
+        // payload在保存线程中释放，不占用GUI线程；
+        // 映射文件的QFile属于GUI线程，随完成通知送回GUI线程释放
+        quint64 revision = job.revision;
+        QString file_path = job.file_path;
+        std::shared_ptr<QFile> mapped_file = std::move(job.image.mapped_file);
+        job = {};
+        QMetaObject::invokeMethod(
+            this,
+            [this, revision, file_path, error_string, mapped_file = std::move(mapped_file)] { onSaveFinished(revision, file_path, error_string); },
+            Qt::QueuedConnection);
+    }
+}
+
+void QmTimelineAutosaver::onSaveFinished(quint64 revision, const QString& file_path, const QString& error_string)
+{
+    --d_->outstanding_jobs;
+    if (!error_string.isEmpty()) {
+        QMTL_LOG_ERROR("Failed to autosave to {}. {}", file_path.toStdString(), error_string.toStdString());
+        // 下一次定时保存时重试
+        if (d_->queued_revision == revision) {
+            d_->queued_revision.reset();
+        }
+        emit failed(error_string);
+        return;
+    }
+    d_->saved_revision = revision;
+    d_->model->resetDirty(revision);
+    emit saved(file_path, revision);
+}
+
+} // namespace qmtl
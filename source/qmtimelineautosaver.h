@@ -0,0 +1,54 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include <QObject>
+
+namespace qmtl {
+
+class QmTimelineItemModel;
+
+struct QmTimelineAutosaverPrivate;
+// 后台自动保存。
+// GUI线程只收集模型的二进制快照(见QmTimelineItemModel::binaryImage)。没有缓存的item payload
+// 先在空闲时分批编码(见QmTimelineItemModel::encodePayloads)，不会一次占用GUI线程编码所有item。
+// 序列化、压缩和写文件在保存线程中完成，先写临时文件再替换目标文件，保存中断时不会损坏上一次的结果。
+// 保存完成后只清除快照包含的修改的dirty标记，保存期间的新修改保持dirty。
+class QMTIMELINE_LIB_EXPORT QmTimelineAutosaver : public QObject {
+    Q_OBJECT
+public:
+    explicit QmTimelineAutosaver(QmTimelineItemModel* model, QObject* parent = nullptr);
+    ~QmTimelineAutosaver() noexcept override;
+
+    void setFilePath(const QString& file_path);
+    QString filePath() const;
+    // 间隔为0时只在调用saveNow()时保存
+    void setInterval(int msec);
+    int interval() const;
+    // qCompress的压缩级别，0为不压缩
+    void setCompressionLevel(int level);
+    int compressionLevel() const;
+
+    // 模型在上一次保存之后有修改时收集快照交给保存线程。
+    // 还有没有缓存的payload时先分批编码，编码完成后在之后的事件循环中收集。
+    // 保存线程忙时只保留最新的快照，中间的快照不再写出
+    void saveNow();
+    bool isSaving() const;
+    // 最近一次成功写出的模型版本
+    quint64 savedRevision() const;
+
+    // 读取自动保存的文件
+    static bool restore(QmTimelineItemModel* model, const QString& file_path);
+
+signals:
+    void saved(const QString& file_path, quint64 revision);
+    void failed(const QString& error_string);
+
+private:
+    void run();
+    void onSaveFinished(quint64 revision, const QString& file_path, const QString& error_string);
+
+private:
+    QmTimelineAutosaverPrivate* d_ { nullptr };
+};
+
+} // namespace qmtl
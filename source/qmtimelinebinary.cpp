@@ -0,0 +1,237 @@
+#include "qmtimelinebinary.h"
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace qmtl {
+
+namespace {
+template <typename T>
+T readValue(const char*& data)
+{
+    T value = qFromLittleEndian<T>(data);
+    data += sizeof(T);
+    return value;
+}
+
+double readDouble(const char*& data)
+{
+    quint64 bits = readValue<quint64>(data);
+    double value = 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void writeRowSet(QDataStream& stream, const std::set<int>& rows)
+{
+    stream << static_cast<quint32>(rows.size());
+    for (int row : rows) {
+        stream << static_cast<qint32>(row);
+    }
+}
+
+bool readRowSet(const char*& data, const char* end, std::set<int>& rows)
+{
+    if (end - data < static_cast<qsizetype>(sizeof(quint32))) {
+        return false;
+    }
+    quint32 count = readValue<quint32>(data);
+    if (static_cast<quint64>(end - data) < static_cast<quint64>(count) * sizeof(qint32)) {
+        return false;
+    }
+    rows.clear();
+    for (quint32 i = 0; i < count; ++i) {
+        rows.emplace_hint(rows.end(), readValue<qint32>(data));
+    }
+    return true;
+}
+
+bool isSectionInRange(quint64 offset, quint64 length, qsizetype size)
+{
+    return offset <= static_cast<quint64>(size) && length <= static_cast<quint64>(size) - offset;
+}
+} // namespace
+
+void QmTimelineBinaryFormat::writeHeader(QDataStream& stream, const QmTimelineBinaryHeader& header)
+{
+    stream << header.magic << header.version << header.id_index;
+    stream << header.frame_range[0] << header.frame_range[1];
+    stream << header.view_frame_range[0] << header.view_frame_range[1];
+    stream << header.fps;
+    stream << header.item_count << header.conn_count;
+    stream << header.rows_offset << header.items_offset << header.conns_offset << header.payload_offset << header.payload_size;
+}
+
+void QmTimelineBinaryFormat::writeRowStates(QDataStream& stream, const QmTimelineBinaryRowStates& states)
+{
+    writeRowSet(stream, states.hidden_rows);
+    writeRowSet(stream, states.locked_rows);
+    writeRowSet(stream, states.disabled_rows);
+}
+
+qsizetype QmTimelineBinaryFormat::rowStatesSize(const QmTimelineBinaryRowStates& states)
+{
+    return static_cast<qsizetype>(3 * sizeof(quint32)
+        + (states.hidden_rows.size() + states.locked_rows.size() + states.disabled_rows.size()) * sizeof(qint32));
+}
+
+void QmTimelineBinaryFormat::writeItemRecord(QDataStream& stream, const QmTimelineBinaryItemRecord& record)
+{
+    stream << record.id << record.start << record.duration << record.payload_offset << record.payload_size << record.flags;
+}
+
+void QmTimelineBinaryFormat::writeConnRecord(QDataStream& stream, const QmItemConnID& conn_id)
+{
+    stream << conn_id.from << conn_id.to;
+}
+
+bool QmTimelineBinaryFormat::writeImage(QDataStream& stream, const QmTimelineBinaryImage& image)
+{
+    struct ImageItem {
+        QmTimelineBinaryItemRecord record;
+        QByteArrayView payload;
+    };
+    // 区间取自行索引，payload和标志取自缓存；没有缓存的是尚未创建的item，从映射的记录中读取
+    std::vector<ImageItem> items;
+    items.reserve(image.item_count);
+    // {item_id: 在items中的位置}
+    std::unordered_map<QmItemID, std::size_t> lazy_items;
+    for (const auto& [_, index] : image.rows) {
+        for (const auto& entry : index.all()) {
+            ImageItem item;
+            item.record.id = entry.id;
+            item.record.start = entry.start;
+            item.record.duration = entry.end - entry.start;
+            if (const auto* cached = image.payloads.find(entry.id); cached) {
+                item.record.flags = cached->flags;
+                item.payload = cached->payload;
+            } else {
+                lazy_items.emplace(entry.id, items.size());
+            }
+            items.push_back(item);
+        }
+    }
+    if (!lazy_items.empty() && image.mapped_data) {
+        const char* records = image.mapped_data + image.mapped_header.items_offset;
+        const char* payloads = image.mapped_data + image.mapped_header.payload_offset;
+        for (quint64 i = 0; i < image.mapped_header.item_count && !lazy_items.empty(); ++i) {
+            auto record = readItemRecord(records + i * kItemRecordSize);
+            auto it = lazy_items.find(record.id);
+            if (it == lazy_items.end()) {
+                continue;
+            }
+            auto& item = items[it->second];
+            item.record.flags = record.flags;
+            item.payload = QByteArrayView(payloads + record.payload_offset, record.payload_size);
+            lazy_items.erase(it);
+        }
+    }
+    if (!lazy_items.empty()) {
+        return false;
+    }
+    std::sort(items.begin(), items.end(), [](const ImageItem& lhs, const ImageItem& rhs) { return lhs.record.id < rhs.record.id; });
+
+    quint64 payload_size = 0;
+    for (const auto& item : items) {
+        payload_size += static_cast<quint64>(item.payload.size());
+    }
+    quint64 conn_count = image.conns ? image.conns->size() : 0;
+
+    // prev_conns与next_conns互为镜像，只保存next_conns
+    QmTimelineBinaryHeader header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.id_index = image.id_index;
+    header.frame_range = image.frame_range;
+    header.view_frame_range = image.view_frame_range;
+    header.fps = image.fps;
+    header.item_count = items.size();
+    header.conn_count = conn_count;
+    header.rows_offset = kHeaderSize;
+    header.items_offset = header.rows_offset + rowStatesSize(image.states);
+    header.conns_offset = header.items_offset + header.item_count * kItemRecordSize;
+    header.payload_offset = header.conns_offset + header.conn_count * kConnRecordSize;
+    header.payload_size = payload_size;
+
+    writeHeader(stream, header);
+    writeRowStates(stream, image.states);
+    quint64 payload_offset = 0;
+    for (auto& item : items) {
+        item.record.payload_offset = payload_offset;
+        item.record.payload_size = static_cast<quint32>(item.payload.size());
+        writeItemRecord(stream, item.record);
+        payload_offset += item.record.payload_size;
+    }
+    if (image.conns) {
+        for (const auto& [_, conn_id] : *image.conns) {
+            writeConnRecord(stream, conn_id);
+        }
+    }
+    for (const auto& item : items) {
+        stream.writeRawData(item.payload.data(), item.payload.size());
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool QmTimelineBinaryFormat::readHeader(const char* data, qsizetype size, QmTimelineBinaryHeader& header)
+{
+    if (size < kHeaderSize) {
+        return false;
+    }
+    header.magic = readValue<quint32>(data);
+    header.version = readValue<quint32>(data);
+    if (header.magic != kMagic || header.version != kVersion) {
+        return false;
+    }
+    header.id_index = readValue<quint64>(data);
+    header.frame_range[0] = readValue<qint64>(data);
+    header.frame_range[1] = readValue<qint64>(data);
+    header.view_frame_range[0] = readValue<qint64>(data);
+    header.view_frame_range[1] = readValue<qint64>(data);
+    header.fps = readDouble(data);
+    header.item_count = readValue<quint64>(data);
+    header.conn_count = readValue<quint64>(data);
+    header.rows_offset = readValue<quint64>(data);
+    header.items_offset = readValue<quint64>(data);
+    header.conns_offset = readValue<quint64>(data);
+    header.payload_offset = readValue<quint64>(data);
+    header.payload_size = readValue<quint64>(data);
+
+    // 记录数过大时乘法会溢出，先与文件大小比较
+    if (header.item_count > static_cast<quint64>(size) / kItemRecordSize || header.conn_count > static_cast<quint64>(size) / kConnRecordSize) {
+        return false;
+    }
+    return isSectionInRange(header.rows_offset, 0, size) && isSectionInRange(header.items_offset, header.item_count * kItemRecordSize, size)
+        && isSectionInRange(header.conns_offset, header.conn_count * kConnRecordSize, size)
+        && isSectionInRange(header.payload_offset, header.payload_size, size);
+}
+
+bool QmTimelineBinaryFormat::readRowStates(const char* data, qsizetype size, QmTimelineBinaryRowStates& states)
+{
+    const char* end = data + size;
+    return readRowSet(data, end, states.hidden_rows) && readRowSet(data, end, states.locked_rows) && readRowSet(data, end, states.disabled_rows);
+}
+
+QmTimelineBinaryItemRecord QmTimelineBinaryFormat::readItemRecord(const char* data)
+{
+    QmTimelineBinaryItemRecord record;
+    record.id = readValue<quint64>(data);
+    record.start = readValue<qint64>(data);
+    record.duration = readValue<qint64>(data);
+    record.payload_offset = readValue<quint64>(data);
+    record.payload_size = readValue<quint32>(data);
+    record.flags = readValue<quint32>(data);
+    return record;
+}
+
+QmItemConnID QmTimelineBinaryFormat::readConnRecord(const char* data)
+{
+    QmItemConnID conn_id;
+    conn_id.from = readValue<quint64>(data);
+    conn_id.to = readValue<quint64>(data);
+    return conn_id;
+}
+
+} // namespace qmtl
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinepayloadcache.h"
+#include "qmtimelinerowindex.h"
+#include "qmtimelinetype.h"
+#include <QByteArray>
+#include <array>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+class QDataStream;
+class QFile;
+
+namespace qmtl {
+
+// 二进制快照文件头，所有字段均为小端
+// 文件布局: [文件头][行状态][item记录表][连接记录表][payload数据区]
+struct QmTimelineBinaryHeader {
+    quint32 magic { 0 };
+    quint32 version { 0 };
+    QmItemID id_index { 0 };
+    std::array<qint64, 2> frame_range { 0, 1 };
+    std::array<qint64, 2> view_frame_range { 0, 1 };
+    double fps { 24.0 };
+    quint64 item_count { 0 };
+    quint64 conn_count { 0 };
+    // 各段相对文件开头的偏移
+    quint64 rows_offset { 0 };
+    quint64 items_offset { 0 };
+    quint64 conns_offset { 0 };
+    quint64 payload_offset { 0 };
+    quint64 payload_size { 0 };
+};
+
+// 定长item记录，payload_offset相对payload数据区开头
+struct QmTimelineBinaryItemRecord {
+    QmItemID id { kInvalidItemID };
+    qint64 start { 0 };
+    qint64 duration { 0 };
+    quint64 payload_offset { 0 };
+    quint32 payload_size { 0 };
+    quint32 flags { 0 };
+};
+
+struct QmTimelineBinaryRowStates {
+    std::set<int> hidden_rows;
+    std::set<int> locked_rows;
+    std::set<int> disabled_rows;
+};
+
+// 写出一个二进制快照所需的全部数据，由model在GUI线程收集(见QmTimelineItemModel::binaryImage)。
+// 行索引、payload缓存和连接表都与模型共享，收集只复制引用；item记录由writeImage建立，可以交给其他线程写出
+struct QmTimelineBinaryImage {
+    QmItemID id_index { 0 };
+    std::array<qint64, 2> frame_range { 0, 1 };
+    std::array<qint64, 2> view_frame_range { 0, 1 };
+    double fps { 24.0 };
+    QmTimelineBinaryRowStates states;
+    // item的区间
+    std::map<int, QmTimelineRowIndex> rows;
+    qsizetype item_count { 0 };
+    // 已创建item的payload和标志
+    QmTimelinePayloadCache payloads;
+    std::shared_ptr<const QmTimelineConnTable> conns;
+    // 尚未创建的item的记录和payload直接引用映射的文件，写出之前不能解除映射
+    std::shared_ptr<QFile> mapped_file;
+    // 映射已复制到内存时，mapped_data指向这块缓冲区
+    QByteArray mapped_buffer;
+    const char* mapped_data { nullptr };
+    QmTimelineBinaryHeader mapped_header;
+};
+
+class QMTIMELINE_LIB_EXPORT QmTimelineBinaryFormat {
+public:
+    static constexpr quint32 kMagic = 0x4C544D51; // "QMTL"
+    static constexpr quint32 kVersion = 1;
+    static constexpr qsizetype kHeaderSize = 112;
+    static constexpr qsizetype kItemRecordSize = 40;
+    static constexpr qsizetype kConnRecordSize = 16;
+
+    enum ItemFlag : quint32 {
+        ItemEnabled = 0x01,
+    };
+
+    static void writeHeader(QDataStream& stream, const QmTimelineBinaryHeader& header);
+    static void writeRowStates(QDataStream& stream, const QmTimelineBinaryRowStates& states);
+    static qsizetype rowStatesSize(const QmTimelineBinaryRowStates& states);
+    static void writeItemRecord(QDataStream& stream, const QmTimelineBinaryItemRecord& record);
+    static void writeConnRecord(QDataStream& stream, const QmItemConnID& conn_id);
+    // 按文件布局写出整个快照，item记录按id升序。payload缺失或流的状态异常时返回false
+    static bool writeImage(QDataStream& stream, const QmTimelineBinaryImage& image);
+
+    // 以下函数直接解析内存中的数据，调用者需保证data至少包含对应段的长度
+    // 文件头无效或各段超出size时返回false
+    static bool readHeader(const char* data, qsizetype size, QmTimelineBinaryHeader& header);
+    static bool readRowStates(const char* data, qsizetype size, QmTimelineBinaryRowStates& states);
+    static QmTimelineBinaryItemRecord readItemRecord(const char* data);
+    static QmItemConnID readConnRecord(const char* data);
+};
+
+} // namespace qmtl
@@ -1,4 +1,5 @@
 #include "qmtimelineitem.h"
+#include "qmtimelineitemfactory.h"
 #include "qmtimelineitemmodel.h"
 #include "qmtimelinelog.h"
 #include <QCoreApplication>
@@ -6,14 +7,10 @@
 namespace qmtl {
 
 QmTimelineItem::QmTimelineItem(QmItemID item_id, QmTimelineItemModel* model)
-    : model_(model)
+    : palette_(QmTimelineItemFactory::instance().itemPalette(QmTimelineItemModel::itemType(item_id)))
+    , model_(model)
     , item_id_(item_id)
 {
-    palette_.setBrush(QPalette::Base, QColor("#006064"));
-    palette_.setBrush(QPalette::Disabled, QPalette::Base, Qt::gray);
-    palette_.setBrush(QPalette::AlternateBase, QColor("#006064"));
-    palette_.setColor(QPalette::Text, Qt::white);
-    palette_.setColor(QPalette::Disabled, QPalette::Text, Qt::darkGray);
 }
 
 void QmTimelineItem::setNumber(int number)
@@ -26,12 +23,18 @@ void QmTimelineItem::setNumber(int number)
     notifyPropertyChanged(NumberRole);
 }
 
+int QmTimelineItem::number() const
+{
+    int number = model_ ? model_->itemNumber(item_id_) : 0;
+    return number > 0 ? number : number_;
+}
+
 void QmTimelineItem::setStart(qint64 frame_no)
 {
     if (frame_no == start_) {
         return;
     }
-    int old_start = start_;
+    qint64 old_start = start_;
     start_ = frame_no;
     setDirty(true);
     notifyPropertyChanged(StartRole | ToolTipRole, old_start);
@@ -119,7 +122,7 @@ std::optional<QVariant> QmTimelineItem::property(int role) const
     case DurationRole:
         return duration_;
     case NumberRole:
-        return number_;
+        return number();
     case EnabledRole:
         return enabled_;
     default:
@@ -131,12 +134,6 @@ std::optional<QVariant> QmTimelineItem::property(int role) const
 bool QmTimelineItem::operate(int op_role, const QVariant& param)
 {
     switch (op_role) {
-    case OperationRole::OpIncreaseNumberRole:
-        setNumber(number_ + param.toInt());
-        return true;
-    case OperationRole::OpDecreaseNumberRole:
-        setNumber(number_ - param.toInt());
-        return true;
     case OperationRole::OpUpdateAsHead:
     case OperationRole::OpUpdateAsTail:
         model_->notifyItemOperateFinished(item_id_, op_role);
@@ -152,6 +149,16 @@ const QPalette& QmTimelineItem::palette() const
     return palette_;
 }
 
+void QmTimelineItem::setPalette(const QPalette& palette)
+{
+    palette_ = palette;
+}
+
+void QmTimelineItem::resetPalette()
+{
+    palette_ = QmTimelineItemFactory::instance().itemPalette(QmTimelineItemModel::itemType(item_id_));
+}
+
 QList<QmTimelineItem::PropertyElement> QmTimelineItem::editableProperties() const
 {
     QList<QmTimelineItem::PropertyElement> elements;
@@ -195,13 +202,48 @@ bool QmTimelineItem::load(const nlohmann::json& j)
 nlohmann::json QmTimelineItem::save() const
 {
     nlohmann::json j;
-    j["number"] = number_;
+    j["number"] = number();
     j["start"] = start_;
     j["duration"] = duration_;
     j["enabled"] = enabled_;
     return j;
 }
 
+QByteArray QmTimelineItem::saveBinary() const
+{
+    nlohmann::json j = save();
+    if (!j.is_object()) {
+        return {};
+    }
+    for (const char* key : { "number", "start", "duration", "enabled" }) {
+        j.erase(key);
+    }
+    if (j.empty()) {
+        return {};
+    }
+    auto bytes = nlohmann::json::to_cbor(j);
+    return QByteArray(reinterpret_cast<const char*>(bytes.data()), static_cast<qsizetype>(bytes.size()));
+}
+
+bool QmTimelineItem::loadBinary(QByteArrayView payload)
+{
+    if (payload.isEmpty()) {
+        return true;
+    }
+    try {
+        auto j = nlohmann::json::from_cbor(payload.begin(), payload.end());
+        // 补全定长记录中的字段，使子类的load可以按JSON格式读取
+        j["number"] = number_;
+        j["start"] = start_;
+        j["duration"] = duration_;
+        j["enabled"] = enabled_;
+        return load(j);
+    } catch (const nlohmann::json::exception& except) {
+        QMTL_LOG_ERROR("Failed to load item payload. Exception: {}", except.what());
+    }
+    return false;
+}
+
 void QmTimelineItem::notifyPropertyChanged(int role, const QVariant& old_value)
 {
     model_->notifyItemPropertyChanged(item_id_, role, old_value);
@@ -224,11 +266,22 @@ void QmTimelineItem::updateBuddyProperty(int role, const QVariant& param)
     }
 }
 
+void QmTimelineItem::framesShifted(qint64)
+{
+}
+
+void QmTimelineItem::framesRescaled(double)
+{
+}
+
 void from_json(const nlohmann::json& j, QmTimelineItem& item)
 {
     j["number"].get_to(item.number_);
     j["start"].get_to<qint64>(item.start_);
     j["duration"].get_to<qint64>(item.duration_);
+    if (j.contains("enabled")) {
+        j["enabled"].get_to(item.enabled_);
+    }
 }
 
 } // namespace qmtl
@@ -3,6 +3,7 @@
 #include "qmtimeline_global.h"
 #include "qmtimelineserializable.h"
 #include "qmtimelinetype.h"
+#include <QByteArrayView>
 #include <QObject>
 #include <QPalette>
 #include <QVariant>
@@ -23,9 +24,9 @@ public:
         AllRole = std::numeric_limits<int>::max()
     };
 
+    // 序号由model按行内序位计算，不再通过操作逐个增减，
+    // 需要随序号更新状态的子类连接QmTimelineItemModel::rowNumbersChanged
     enum OperationRole : int {
-        OpIncreaseNumberRole = 0x01,
-        OpDecreaseNumberRole = 0x02,
         OpUpdateAsHead = 0x04,
         OpUpdateAsTail = 0x08,
     };
@@ -69,12 +70,14 @@ public:
     inline bool isDirty() const;
     inline void setDirty(bool dirty);
     inline void resetDirty();
-    inline int number() const;
+    // 序号即item在所在行中的序位，由model按需计算
+    int number() const;
 
     virtual bool isValid() const;
     inline bool isEnabled() const;
     void setEnabled(bool enabled);
 
+    // 默认与同类型的item共享一份调色板(见QmTimelineItemFactory::itemPalette)
     const QPalette& palette() const;
 
     virtual int type() const;
@@ -96,10 +99,23 @@ public:
     bool load(const nlohmann::json& j) override;
     nlohmann::json save() const override;
 
+    // 二进制快照中item的扩展数据。start/duration/enabled已保存在定长记录中，
+    // 默认实现保存save()中其余字段的CBOR编码，子类可重写为更紧凑的格式
+    virtual QByteArray saveBinary() const;
+    virtual bool loadBinary(QByteArrayView payload);
+
 protected:
     inline constexpr static PropertyRole userRole(qint64 index);
 
     virtual void updateBuddyProperty(int role, const QVariant& param);
+    // 波纹编辑不经过setStart，直接把start平移delta帧后调用，子类据此更新由start推导的状态
+    virtual void framesShifted(qint64 delta);
+    // 帧率转换不经过setStart/setDuration，二者按ratio(新帧率/旧帧率)缩放之后调用，此时model()->fps()已是新的帧率
+    virtual void framesRescaled(double ratio);
+
+    // 需要单独配色的item可调用setPalette或直接修改palette_，修改时才复制出自己的调色板
+    void setPalette(const QPalette& palette);
+    void resetPalette();
 
     void notifyPropertyChanged(int role, const QVariant& old_value = QVariant());
     void blockBuddyUpdate(int role);
@@ -107,8 +123,10 @@ protected:
 
 protected:
     QMTIMELINE_LIB_EXPORT friend void from_json(const nlohmann::json& j, QmTimelineItem& item);
+    // 构造时浅拷贝该类型共享的调色板，未修改前不占用单独的数据
     QPalette palette_;
     // 数据部分
+    // 序号，仅在登记到model之前使用
     int number_ { 0 };
     // 起始帧
     qint64 start_ { 0 };
@@ -121,6 +139,8 @@ protected:
 
 private:
     Q_DISABLE_COPY(QmTimelineItem)
+    // 波纹编辑、帧率转换直接修改start_和duration_，不逐个发出属性通知
+    friend class QmTimelineItemModel;
     QmItemID item_id_ { kInvalidItemID };
     QmTimelineItemModel* model_ { nullptr };
     bool dirty_ { false };
@@ -177,11 +197,6 @@ inline bool QmTimelineItem::isEnabled() const
     return enabled_;
 }
 
-inline int QmTimelineItem::number() const
-{
-    return number_;
-}
-
 inline constexpr QmTimelineItem::PropertyRole QmTimelineItem::userRole(qint64 index)
 {
     assert(index < 32 && "The role must be less than 32.");
@@ -4,6 +4,7 @@
 #include "qmtimelineitemview.h"
 #include "qmtimelinelog.h"
 #include "qmtimelinescene.h"
+#include "qmtimelineshadow.h"
 #include "qmtimelineview.h"
 #include <QGraphicsDropShadowEffect>
 #include <QPainter>
@@ -18,14 +19,7 @@ QmTimelineItemConnView::QmTimelineItemConnView(const QmItemConnID& conn_id, QmTi
 {
     scene.addItem(this);
     setZValue(1);
-
-    {
-        QGraphicsDropShadowEffect* effect = new QGraphicsDropShadowEffect(this);
-        effect->setColor(Qt::black);
-        effect->setBlurRadius(20);
-        effect->setOffset(0);
-        setGraphicsEffect(effect);
-    }
+    setShadowMode(scene.shadowMode());
 
     updateX();
     updateY();
@@ -88,12 +82,22 @@ void QmTimelineItemConnView::paint(QPainter* painter, const QStyleOptionGraphics
     }
     {
         // 绘制连线
-        if (label_rect.width() < label_max_width) {
-            painter->drawLine(left + triangle_edge, center_y, label_rect.left(), center_y);
-            painter->drawLine(label_rect.right(), center_y, right - triangle_edge, center_y);
-        } else {
-            painter->drawLine(left + triangle_edge, center_y, right - triangle_edge, center_y);
+        auto draw_lines = [&] {
+            if (label_rect.width() < label_max_width) {
+                painter->drawLine(left + triangle_edge, center_y, label_rect.left(), center_y);
+                painter->drawLine(label_rect.right(), center_y, right - triangle_edge, center_y);
+            } else {
+                painter->drawLine(left + triangle_edge, center_y, right - triangle_edge, center_y);
+            }
+        };
+        if (shadow_mode_ == QmShadowMode::Cached) {
+            // 连线只有一个像素宽，用一条半透明的粗线代替模糊阴影
+            painter->save();
+            painter->setPen(QPen(QColor(0, 0, 0, 80), 3));
+            draw_lines();
+            painter->restore();
         }
+        draw_lines();
     }
 }
 
@@ -195,4 +199,26 @@ void QmTimelineItemConnView::updateGeometry()
     update();
 }
 
+void QmTimelineItemConnView::setShadowMode(QmShadowMode mode)
+{
+    if (mode == shadow_mode_) {
+        return;
+    }
+    shadow_mode_ = mode;
+    setGraphicsEffect(nullptr);
+    if (mode == QmShadowMode::Effect) {
+        QGraphicsDropShadowEffect* effect = new QGraphicsDropShadowEffect(this);
+        effect->setColor(Qt::black);
+        effect->setBlurRadius(QmTimelineShadowItem::kBlurRadius);
+        effect->setOffset(0);
+        setGraphicsEffect(effect);
+    }
+    update();
+}
+
+QmShadowMode QmTimelineItemConnView::shadowMode() const
+{
+    return shadow_mode_;
+}
+
 } // namespace qmtl
\ No newline at end of file
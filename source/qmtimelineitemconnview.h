@@ -20,6 +20,9 @@ public:
     void updateY();
     void updateGeometry();
 
+    void setShadowMode(QmShadowMode mode);
+    QmShadowMode shadowMode() const;
+
 public:
     enum {
         Type = UserType + 100
@@ -34,6 +37,7 @@ private:
     QmItemConnID conn_id_;
     QmTimelineScene& scene_;
     QFontMetricsF font_metrics_;
+    QmShadowMode shadow_mode_ { QmShadowMode::None };
 };
 
 } // namespace qmtl
\ No newline at end of file
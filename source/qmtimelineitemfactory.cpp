@@ -71,6 +71,29 @@ bool QmTimelineItemFactory::itemHasConnection(QmItemID item_id) const
     return creator->with_connection;
 }
 
+const QPalette& QmTimelineItemFactory::itemPalette(int item_type) const
+{
+    auto it = d_->creator_map.find(item_type);
+    if (it == d_->creator_map.end() || !it->second->palette) {
+        return defaultItemPalette();
+    }
+    return *it->second->palette;
+}
+
+const QPalette& QmTimelineItemFactory::defaultItemPalette()
+{
+    static const QPalette palette = [] {
+        QPalette result;
+        result.setBrush(QPalette::Base, QColor("#006064"));
+        result.setBrush(QPalette::Disabled, QPalette::Base, Qt::gray);
+        result.setBrush(QPalette::AlternateBase, QColor("#006064"));
+        result.setColor(QPalette::Text, Qt::white);
+        result.setColor(QPalette::Disabled, QPalette::Text, Qt::darkGray);
+        return result;
+    }();
+    return palette;
+}
+
 bool QmTimelineItemFactory::registerItemType(int type, std::unique_ptr<QmTimelineItemCreateor>&& creator)
 {
     if (!creator) {
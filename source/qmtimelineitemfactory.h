@@ -2,7 +2,9 @@
 
 #include "qmtimeline_global.h"
 #include "qmtimelinetype.h"
+#include <QPalette>
 #include <memory>
+#include <optional>
 
 namespace qmtl {
 
@@ -15,6 +17,8 @@ struct QmTimelineItemCreateor {
     bool with_connection = false;
     std::function<std::unique_ptr<QmTimelineItem>(QmItemID, QmTimelineItemModel*)> item_creator;
     std::function<std::unique_ptr<QmTimelineItemView>(QmItemID, QmTimelineScene*)> item_view_creator;
+    // 该类型所有item共享的调色板，未设置时使用defaultItemPalette()
+    std::optional<QPalette> palette;
 };
 
 struct QmTimelineItemFactoryPrivate;
@@ -28,6 +32,10 @@ public:
 
     bool itemHasConnection(QmItemID item_id) const;
 
+    // 同一类型的item共享一份调色板，不会为每个item复制
+    const QPalette& itemPalette(int item_type) const;
+    static const QPalette& defaultItemPalette();
+
     bool registerItemType(int type, std::unique_ptr<QmTimelineItemCreateor>&& creator);
     bool unRegisterItemType(int type);
     bool hasItemType(int type) const;
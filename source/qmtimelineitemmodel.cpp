@@ -1,9 +1,26 @@
 #include "qmtimelineitemmodel.h"
+#include "qmtimelinebinary.h"
 #include "qmtimelineitem.h"
 #include "qmtimelineitemfactory.h"
+#include "qmtimelineitemslotmap.h"
+#include "qmtimelinejsonstreamreader.h"
 #include "qmtimelinelog.h"
+#include "qmtimelinemodelsnapshot.h"
+#include "qmtimelinepayloadcache.h"
+#include "qmtimelinerowindex.h"
+#include "qmtimelinerowoffsets.h"
 #include "qmtimelineutil.h"
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtEndian>
+#include <cmath>
+#include <map>
 #include <set>
+#include <unordered_set>
 
 namespace nlohmann {
 void from_json(const nlohmann::json& j, qmtl::QmItemConnID& conn_id)
@@ -21,29 +38,418 @@ void to_json(nlohmann::json& j, const qmtl::QmItemConnID& conn_id)
 
 namespace qmtl {
 
+namespace {
+// 浮点比例的误差不应改变整除时的结果，例如24帧转25帧时第24帧应当正好落在第25帧
+constexpr double kFrameEpsilon = 1e-6;
+
+template <QmFrameRounding Rounding>
+qint64 roundFrame(double frame)
+{
+    if constexpr (Rounding == QmFrameRounding::Floor) {
+        return static_cast<qint64>(std::floor(frame + kFrameEpsilon));
+    } else if constexpr (Rounding == QmFrameRounding::Ceil) {
+        return static_cast<qint64>(std::ceil(frame - kFrameEpsilon));
+    } else {
+        return static_cast<qint64>(std::floor(frame + 0.5));
+    }
+}
+
+// 舍入方式在循环外确定，循环体只有乘法和舍入，编译器可以向量化
+template <QmFrameRounding Rounding>
+void scaleFrames(std::span<const qint64> frames, qint64 bias, double ratio, qint64* out)
+{
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        out[i] = roundFrame<Rounding>(static_cast<double>(frames[i] + bias) * ratio) - bias;
+    }
+}
+
+// bias在缩放前加上、缩放后减去：区间的end按下一帧的起点缩放，相邻的item转换后仍然相邻
+void scaleFrames(std::span<const qint64> frames, qint64 bias, double ratio, QmFrameRounding rounding, std::vector<qint64>& out)
+{
+    out.resize(frames.size());
+    switch (rounding) {
+    case QmFrameRounding::Floor:
+        scaleFrames<QmFrameRounding::Floor>(frames, bias, ratio, out.data());
+        break;
+    case QmFrameRounding::Ceil:
+        scaleFrames<QmFrameRounding::Ceil>(frames, bias, ratio, out.data());
+        break;
+    default:
+        scaleFrames<QmFrameRounding::Nearest>(frames, bias, ratio, out.data());
+        break;
+    }
+}
+
+// 舍入后区间可能退化(end < start)或与前一个重叠：从左到右依次后推，保留舍入后的长度，
+// 结果只取决于行内的顺序
+void resolveCollisions(std::vector<qint64>& starts, std::vector<qint64>& ends)
+{
+    qint64 min_start = std::numeric_limits<qint64>::min();
+    for (std::size_t i = 0; i < starts.size(); ++i) {
+        qint64 duration = qMax<qint64>(ends[i] - starts[i], 0);
+        starts[i] = qMax(starts[i], min_start);
+        ends[i] = starts[i] + duration;
+        min_start = ends[i] + 1;
+    }
+}
+} // namespace
+
 struct QmTimelineItemModelPrivate {
-    std::map<QmItemID, std::unique_ptr<QmTimelineItem>> items;
-    // {row_id: {start: item_id}}
-    std::map<int, std::map<qint64, QmItemID>> item_table;
-    // {row_id: {item_id: start}}
-    std::map<int, std::unordered_map<QmItemID, qint64>> item_table_helper;
+    QmTimelineItemSlotMap items;
+    // {row_id: 按start排序的item区间索引}，只保留非空的行
+    std::map<int, QmTimelineRowIndex> item_table;
     std::set<int> hidden_rows;
     std::set<int> locked_rows;
     std::set<int> disabled_rows;
     std::map<QmItemID, QmItemConnID> next_conns;
     std::map<QmItemID, QmItemConnID> prev_conns;
+    // 快照使用的连接表副本，连接变化时清空，下一次snapshot()时重新复制
+    std::shared_ptr<const QmTimelineConnTable> next_conns_snapshot;
+    std::shared_ptr<const QmTimelineConnTable> prev_conns_snapshot;
     QmItemID id_index { 1 };
     std::array<qint64, 2> frame_range { 0, 1 };
     std::array<qint64, 2> view_frame_range { 0, 1 };
     double fps { 24.0 };
 
     bool dirty { false };
+    // 每次修改递增，用于判断某个快照之后是否又有修改
+    quint64 revision { 0 };
+    // {item_id: saveBinary()的结果}，item属性改变时移除。写时复制，自动保存时与保存线程共享
+    QmTimelinePayloadCache payload_cache;
+    // 没有缓存payload的item，由encodePayloads在空闲时分批编码。
+    // 每个已创建的item要么有缓存，要么在这里登记；可能包含已删除或已缓存的id，编码时跳过
+    std::vector<QmItemID> payload_misses;
     std::map<int, qreal> row_heights;
     qreal default_item_height { 40 };
+    // 非空且未隐藏的行的高度前缀和，itemY直接查询
+    QmTimelineRowOffsets row_offsets;
 
     std::function<qreal(QmItemID)> item_y_calculator;
+
+    int batch_depth { 0 };
+    QmItemBatchChange batch_change;
+    // {row_id: 批量编辑中第一次修改该行之前的头尾item}
+    std::map<int, std::pair<QmItemID, QmItemID>> batch_rows;
+
+    // 内存映射加载时尚未创建的item
+    struct LazyItem {
+        // 记录序号
+        quint64 record_pos { 0 };
+        // 波纹编辑、帧率转换累计的修改，映射的记录是只读的
+        qint64 start_offset { 0 };
+        qint64 duration_offset { 0 };
+    };
+    std::unordered_map<QmItemID, LazyItem> lazy_items;
+    std::shared_ptr<QFile> mapped_file;
+    // 保存到映射的文件之前复制出的数据，此时mapped_file为空，mapped_data指向这里
+    QByteArray mapped_buffer;
+    const char* mapped_data { nullptr };
+    QmTimelineBinaryHeader mapped_header;
+
+    QmTimelineRowIndex* rowIndex(int row_id);
+    const QmTimelineRowIndex* rowIndex(int row_id) const;
+    // 查找item在所在行索引中的位置，找不到时返回npos
+    qsizetype locate(QmItemID item_id, const QmTimelineRowIndex& index) const;
+    // 以下两个函数在行由空变为非空(或相反)时返回true，此时之后各行的纵向位置改变
+    bool indexItem(const QmTimelineItem& item);
+    bool unindexItem(QmItemID item_id);
+    void syncItemIndex(const QmTimelineItem& item, const QVariant& old_start);
+    qreal rowHeight(int row_id) const;
+    // 行的可见性、高度或是否为空改变后更新纵向偏移，返回行占用的高度是否改变
+    bool updateRowOffset(int row_id);
+    void rebuildRowOffsets();
+    // 批量编辑中记录行被修改前的头尾，以便结束时刷新
+    void touchBatchRow(int row_id);
+    bool isConnAlive(const QmItemConnID& conn_id) const;
+    void resetConnsSnapshot();
+    void ensureConnsSnapshot();
+    void markDirty();
+    void invalidatePayload(QmItemID item_id);
+    // item刚由payload创建且未修改，payload本身就是saveBinary()的结果
+    void cachePayload(QmItemID item_id, QByteArrayView payload, quint32 flags);
+    // 返回item缓存的payload，没有缓存时先编码
+    const QmTimelinePayloadCache::Entry& ensurePayload(const QmTimelineItem& item);
+    static quint32 itemFlags(const QmTimelineItem& item);
+    // 见QmTimelineItemModel::encodePayloads
+    bool encodePayloads(qsizetype max_items);
+    // 检查加载并排序后的行索引：区间有效、行内不重叠、序号小于文件中的id_index，否则抛出异常
+    void validateLoadedRows(QmItemID file_id_index) const;
+
+    // item的区间，尚未创建的item从映射的记录中读取
+    bool itemSpan(QmItemID item_id, qint64& start, qint64& end) const;
+    QmTimelineBinaryItemRecord lazyRecord(const LazyItem& lazy_item) const;
+    QByteArrayView lazyPayload(const QmTimelineBinaryItemRecord& record) const;
+    void closeMapping();
+    // 把映射的数据复制到mapped_buffer并解除映射，之后可以覆盖原文件
+    void detachMapping();
+    bool isMappedFile(const QString& file_path) const;
 };
 
+QmTimelineRowIndex* QmTimelineItemModelPrivate::rowIndex(int row_id)
+{
+    auto it = item_table.find(row_id);
+    if (it == item_table.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+const QmTimelineRowIndex* QmTimelineItemModelPrivate::rowIndex(int row_id) const
+{
+    auto it = item_table.find(row_id);
+    if (it == item_table.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+qsizetype QmTimelineItemModelPrivate::locate(QmItemID item_id, const QmTimelineRowIndex& index) const
+{
+    qint64 start = 0;
+    qint64 end = 0;
+    if (!itemSpan(item_id, start, end)) {
+        return QmTimelineRowIndex::npos;
+    }
+    qsizetype pos = index.find(item_id, start);
+    if (pos == QmTimelineRowIndex::npos) [[unlikely]] {
+        pos = index.findById(item_id);
+    }
+    return pos;
+}
+
+bool QmTimelineItemModelPrivate::indexItem(const QmTimelineItem& item)
+{
+    int row_id = QmTimelineItemModel::itemRowId(item.itemId());
+    auto& index = item_table[row_id];
+    index.insert(item.itemId(), item.start(), item.end());
+    return index.size() == 1 && updateRowOffset(row_id);
+}
+
+bool QmTimelineItemModelPrivate::unindexItem(QmItemID item_id)
+{
+    auto row_it = item_table.find(QmTimelineItemModel::itemRowId(item_id));
+    if (row_it == item_table.end()) {
+        return false;
+    }
+    qsizetype pos = locate(item_id, row_it->second);
+    if (pos == QmTimelineRowIndex::npos) {
+        return false;
+    }
+    row_it->second.erase(pos);
+    if (!row_it->second.empty()) {
+        return false;
+    }
+    int row_id = row_it->first;
+    item_table.erase(row_it);
+    return updateRowOffset(row_id);
+}
+
+qreal QmTimelineItemModelPrivate::rowHeight(int row_id) const
+{
+    auto it = row_heights.find(row_id);
+    if (it == row_heights.end()) {
+        return default_item_height;
+    }
+    return it->second;
+}
+
+bool QmTimelineItemModelPrivate::updateRowOffset(int row_id)
+{
+    bool visible = item_table.contains(row_id) && !hidden_rows.contains(row_id);
+    return row_offsets.setHeight(row_id, visible ? rowHeight(row_id) : 0);
+}
+
+void QmTimelineItemModelPrivate::rebuildRowOffsets()
+{
+    // 重新累加，避免多次增量修改带来的浮点误差
+    row_offsets.clear();
+    for (const auto& [row_id, _] : item_table) {
+        updateRowOffset(row_id);
+    }
+}
+
+void QmTimelineItemModelPrivate::syncItemIndex(const QmTimelineItem& item, const QVariant& old_start)
+{
+    auto* index = rowIndex(QmTimelineItemModel::itemRowId(item.itemId()));
+    if (!index) {
+        return;
+    }
+    // modifyItemStart会先更新索引，直接调用setStart/setDuration时需要在这里补上
+    qsizetype pos = index->find(item.itemId(), item.start());
+    if (pos == QmTimelineRowIndex::npos && old_start.isValid()) {
+        pos = index->find(item.itemId(), old_start.value<qint64>());
+    }
+    if (pos == QmTimelineRowIndex::npos) [[unlikely]] {
+        pos = index->findById(item.itemId());
+    }
+    if (pos == QmTimelineRowIndex::npos) {
+        return;
+    }
+    if (index->startAt(pos) != item.start()) {
+        index->move(pos, item.start(), item.end());
+    } else {
+        index->setEnd(pos, item.end());
+    }
+}
+
+void QmTimelineItemModelPrivate::touchBatchRow(int row_id)
+{
+    if (batch_depth == 0 || batch_rows.contains(row_id)) {
+        return;
+    }
+    const auto* index = rowIndex(row_id);
+    if (!index || index->empty()) {
+        batch_rows.emplace(row_id, std::make_pair(kInvalidItemID, kInvalidItemID));
+        return;
+    }
+    batch_rows.emplace(row_id, std::make_pair(index->idAt(0), index->idAt(index->size() - 1)));
+}
+
+bool QmTimelineItemModelPrivate::isConnAlive(const QmItemConnID& conn_id) const
+{
+    auto it = next_conns.find(conn_id.from);
+    return it != next_conns.end() && it->second.to == conn_id.to;
+}
+
+void QmTimelineItemModelPrivate::resetConnsSnapshot()
+{
+    next_conns_snapshot.reset();
+    prev_conns_snapshot.reset();
+}
+
+void QmTimelineItemModelPrivate::ensureConnsSnapshot()
+{
+    if (next_conns_snapshot) {
+        return;
+    }
+    next_conns_snapshot = std::make_shared<const QmTimelineConnTable>(next_conns);
+    prev_conns_snapshot = std::make_shared<const QmTimelineConnTable>(prev_conns);
+}
+
+void QmTimelineItemModelPrivate::markDirty()
+{
+    dirty = true;
+    ++revision;
+}
+
+void QmTimelineItemModelPrivate::invalidatePayload(QmItemID item_id)
+{
+    // 没有缓存时已经登记过
+    if (payload_cache.erase(item_id)) {
+        payload_misses.push_back(item_id);
+    }
+}
+
+void QmTimelineItemModelPrivate::cachePayload(QmItemID item_id, QByteArrayView payload, quint32 flags)
+{
+    // 复制一份，映射的文件可能在之后被关闭或复制到别处
+    payload_cache.insert(item_id, { payload.toByteArray(), flags });
+}
+
+const QmTimelinePayloadCache::Entry& QmTimelineItemModelPrivate::ensurePayload(const QmTimelineItem& item)
+{
+    if (const auto* entry = payload_cache.find(item.itemId()); entry) {
+        return *entry;
+    }
+    payload_cache.insert(item.itemId(), { item.saveBinary(), itemFlags(item) });
+    return *payload_cache.find(item.itemId());
+}
+
+bool QmTimelineItemModelPrivate::encodePayloads(qsizetype max_items)
+{
+    qsizetype encoded = 0;
+    while (!payload_misses.empty() && encoded < max_items) {
+        QmItemID item_id = payload_misses.back();
+        payload_misses.pop_back();
+        auto* item = items.find(item_id);
+        if (!item || payload_cache.contains(item_id)) {
+            continue;
+        }
+        ensurePayload(*item);
+        ++encoded;
+    }
+    return payload_misses.empty();
+}
+
+void QmTimelineItemModelPrivate::validateLoadedRows(QmItemID file_id_index) const
+{
+    for (const auto& [_, index] : item_table) {
+        for (qsizetype pos = 0; pos < index.size(); ++pos) {
+            QmItemID item_id = index.idAt(pos);
+            if (index.endAt(pos) < index.startAt(pos)) {
+                throw std::exception(std::format("invalid duration of item[{}]!", item_id).c_str());
+            }
+            // 否则之后createItem会重新发出已存在的id
+            if (QmTimelineItemSlotMap::indexOf(item_id) >= file_id_index) {
+                throw std::exception(std::format("id of item[{}] is not less than id_index!", item_id).c_str());
+            }
+            if (pos > 0 && index.startAt(pos) <= index.endAt(pos - 1)) {
+                throw std::exception(std::format("item[{}] overlaps item[{}]!", item_id, index.idAt(pos - 1)).c_str());
+            }
+        }
+    }
+}
+
+quint32 QmTimelineItemModelPrivate::itemFlags(const QmTimelineItem& item)
+{
+    return item.isEnabled() ? QmTimelineBinaryFormat::ItemEnabled : 0;
+}
+
+bool QmTimelineItemModelPrivate::itemSpan(QmItemID item_id, qint64& start, qint64& end) const
+{
+    if (auto* item = items.find(item_id); item) {
+        start = item->start();
+        end = item->end();
+        return true;
+    }
+    if (auto it = lazy_items.find(item_id); it != lazy_items.end()) {
+        auto record = lazyRecord(it->second);
+        start = record.start;
+        end = record.start + record.duration;
+        return true;
+    }
+    return false;
+}
+
+QmTimelineBinaryItemRecord QmTimelineItemModelPrivate::lazyRecord(const LazyItem& lazy_item) const
+{
+    auto record = QmTimelineBinaryFormat::readItemRecord(
+        mapped_data + mapped_header.items_offset + lazy_item.record_pos * QmTimelineBinaryFormat::kItemRecordSize);
+    record.start += lazy_item.start_offset;
+    record.duration += lazy_item.duration_offset;
+    return record;
+}
+
+QByteArrayView QmTimelineItemModelPrivate::lazyPayload(const QmTimelineBinaryItemRecord& record) const
+{
+    return QByteArrayView(mapped_data + mapped_header.payload_offset + record.payload_offset, record.payload_size);
+}
+
+void QmTimelineItemModelPrivate::closeMapping()
+{
+    lazy_items.clear();
+    mapped_data = nullptr;
+    mapped_header = {};
+    mapped_buffer.clear();
+    // 关闭文件时自动解除映射
+    mapped_file.reset();
+}
+
+void QmTimelineItemModelPrivate::detachMapping()
+{
+    if (!mapped_file) {
+        return;
+    }
+    mapped_buffer = QByteArray(mapped_data, mapped_file->size());
+    mapped_data = mapped_buffer.constData();
+    mapped_file.reset();
+}
+
+bool QmTimelineItemModelPrivate::isMappedFile(const QString& file_path) const
+{
+    return mapped_file && QFileInfo(mapped_file->fileName()) == QFileInfo(file_path);
+}
+
 QmTimelineItemModel::QmTimelineItemModel(QObject* parent)
     : QObject(parent)
     , d_(new QmTimelineItemModelPrivate)
@@ -57,11 +463,11 @@ QmTimelineItemModel::~QmTimelineItemModel() noexcept
 
 QmTimelineItem* QmTimelineItemModel::item(QmItemID item_id) const
 {
-    auto it = d_->items.find(item_id);
-    if (it == d_->items.end()) {
-        return nullptr;
+    auto* item = d_->items.find(item_id);
+    if (!item) [[unlikely]] {
+        return materializeItem(item_id);
     }
-    return it->second.get();
+    return item;
 }
 
 QmTimelineItem* QmTimelineItemModel::itemByStart(int row, qint64 start) const
@@ -75,60 +481,29 @@ QmTimelineItem* QmTimelineItemModel::itemByStart(int row, qint64 start) const
 
 QmItemID QmTimelineItemModel::itemIdByStart(int row, qint64 start) const
 {
-    if (row < 0) {
+    const auto* index = d_->rowIndex(row);
+    if (!index) {
         return kInvalidItemID;
     }
-    auto it = d_->item_table[row].lower_bound(start);
-    if (it == d_->item_table[row].end()) {
+    qsizetype pos = index->lowerBound(start);
+    if (pos >= index->size()) {
         return kInvalidItemID;
     }
-    return it->second;
+    return index->idAt(pos);
 }
 
 bool QmTimelineItemModel::exists(QmItemID item_id) const
 {
-    return d_->items.contains(item_id);
+    return d_->items.contains(item_id) || d_->lazy_items.contains(item_id);
 }
 
 bool QmTimelineItemModel::isFrameRangeOccupied(int row, qint64 start, qint64 duration, QmItemID except_item) const
 {
-    auto row_it = d_->item_table.find(row);
-    if (row_it == d_->item_table.end()) {
-        return false;
-    }
-
-    if (row_it->second.empty()) {
+    const auto* index = d_->rowIndex(row);
+    if (!index) {
         return false;
     }
-
-    auto frame_it = row_it->second.lower_bound(start);
-    // 如果添加至末尾了
-    if (frame_it == row_it->second.end()) {
-        auto* tail_item = item(row_it->second.rbegin()->second);
-        return tail_item && (start <= tail_item->start() + tail_item->duration());
-    }
-
-    if (frame_it->second != except_item) {
-        if (start == frame_it->first || (start + duration >= frame_it->first)) {
-            return true;
-        }
-    }
-
-    if (auto next_frame_it = std::next(frame_it); next_frame_it != row_it->second.end()) {
-        auto* next_item = item(next_frame_it->second);
-        if (next_item != nullptr && start + duration >= next_item->start()) {
-            return true;
-        }
-    }
-
-    if (frame_it != row_it->second.begin()) {
-        auto* prev_item = item(std::prev(frame_it)->second);
-        if (prev_item != nullptr && start <= prev_item->start() + prev_item->duration()) {
-            return true;
-        }
-    }
-
-    return false;
+    return index->isOccupied(start, start + duration, except_item);
 }
 
 QmItemID QmTimelineItemModel::createItem(int item_type, int row, qint64 start, qint64 duration, bool with_connection)
@@ -150,55 +525,28 @@ QmItemID QmTimelineItemModel::createItem(int item_type, int row, qint64 start, q
         return kInvalidItemID;
     }
 
-    // 获取插入位置的item序号，同时修改插入位置之后的item序号
-    std::optional<int> number_opt;
-    if (d_->item_table.contains(row)) {
-        // 插入位置之后的item对应编号加一
-        for (auto it = d_->item_table[row].upper_bound(start); it != d_->item_table[row].end(); ++it) {
-            if (!number_opt) {
-                auto item_number_opt = itemProperty(it->second, QmTimelineItem::NumberRole);
-                if (item_number_opt.has_value()) {
-                    number_opt = item_number_opt->value<int>();
-                }
-            }
-            requestItemOperate(it->second, QmTimelineItem::OperationRole::OpIncreaseNumberRole, 1);
-        }
-    }
-
-    QmItemID old_head = kInvalidItemID;
-    QmItemID old_tail = kInvalidItemID;
-    if (number_opt.has_value()) {
-        if (*number_opt == 1) {
-            old_head = headItem(row);
-        }
-    } else {
-        old_tail = tailItem(row);
+    // 插入位置即新item的序位，之后item的序号由行索引按需计算，无需逐个修改
+    qsizetype pos = 0;
+    if (const auto* index = d_->rowIndex(row); index) {
+        pos = index->upperBound(start);
     }
 
     // 设置新item属性
-    item->setNumber(number_opt.value_or(d_->item_table[row].size() + 1));
+    item->setNumber(static_cast<int>(pos + 1));
     item->setStart(start);
     item->setDuration(duration);
     emit itemAboutToBeCreated(item.get());
 
     // 登记item
+    d_->touchBatchRow(row);
     d_->id_index++;
-    d_->items[item_id] = std::move(item);
-    d_->dirty = true;
-    d_->item_table[row][start] = item_id;
-    d_->item_table_helper[row][item_id] = start;
-    emit itemCreated(item_id);
-
-    if (headItem(row) == item_id) {
-        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsHead);
-    } else if (tailItem(row) == item_id) {
-        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsTail);
-    }
-
-    if (old_head != kInvalidItemID) {
-        requestItemOperate(old_head, QmTimelineItem::OperationRole::OpUpdateAsHead);
-    } else if (old_tail != kInvalidItemID) {
-        requestItemOperate(old_tail, QmTimelineItem::OperationRole::OpUpdateAsTail);
+    bool rows_moved = d_->indexItem(*item);
+    d_->items.insert(item_id, std::move(item));
+    d_->payload_misses.push_back(item_id);
+    d_->markDirty();
+    notifyItemInserted(item_id);
+    if (rows_moved) {
+        emit rowsYChanged(row + 1);
     }
 
     if (with_connection) {
@@ -220,8 +568,7 @@ QmItemID QmTimelineItemModel::createItem(int item_type, int row, qint64 start, q
 
 void QmTimelineItemModel::removeItem(QmItemID item_id)
 {
-    auto item_it = d_->items.find(item_id);
-    if (item_it == d_->items.end()) {
+    if (!exists(item_id)) {
         return;
     }
     // 从item_sorts中删除item_id
@@ -251,46 +598,278 @@ void QmTimelineItemModel::removeItem(QmItemID item_id)
         createFrameConnection(prev_item, next_item);
     }
 
-    if (auto helper_row_it = d_->item_table_helper.find(row_id); helper_row_it != d_->item_table_helper.end()) {
-        if (auto item_origin_it = helper_row_it->second.find(item_id); item_origin_it != helper_row_it->second.end()) {
-            // 后续受影响的item序号需要重新设置
-            for (auto it = d_->item_table[row_id].upper_bound(item_origin_it->second); it != d_->item_table[row_id].end(); ++it) {
-                requestItemOperate(it->second, QmTimelineItem::OperationRole::OpDecreaseNumberRole, 1);
+    // 后续item的序号随之前移
+    qsizetype pos = QmTimelineRowIndex::npos;
+    if (const auto* index = d_->rowIndex(row_id); index) {
+        pos = d_->locate(item_id, *index);
+    }
+    d_->touchBatchRow(row_id);
+    bool rows_moved = d_->unindexItem(item_id);
+    // 信号处理中可能访问过item，此时才确定它是否已经创建
+    if (!d_->items.erase(item_id)) {
+        d_->lazy_items.erase(item_id);
+    }
+    d_->payload_cache.erase(item_id);
+    setDirty();
+    if (rows_moved) {
+        emit rowsYChanged(row_id + 1);
+    }
+    if (d_->batch_depth > 0) {
+        d_->batch_change.removed.push_back(item_id);
+        return;
+    }
+    if (pos != QmTimelineRowIndex::npos && pos < rowItemCount(row_id)) {
+        notifyRowNumbersChanged(row_id, pos);
+    }
+    if (new_head != kInvalidItemID) {
+        requestItemOperate(new_head, QmTimelineItem::OperationRole::OpUpdateAsHead);
+    } else if (new_tail != kInvalidItemID) {
+        requestItemOperate(new_tail, QmTimelineItem::OperationRole::OpUpdateAsTail);
+    }
+    emit itemRemoved(item_id);
+}
+
+qint64 QmTimelineItemModel::moveItems(std::span<const QmItemID> item_ids, qint64 delta)
+{
+    if (delta == 0) {
+        return 0;
+    }
+    // {row_id: 要移动的item在行索引中的位置}
+    std::map<int, std::vector<qsizetype>> row_positions;
+    for (auto item_id : item_ids) {
+        const auto* index = d_->rowIndex(itemRowId(item_id));
+        qsizetype pos = index ? d_->locate(item_id, *index) : QmTimelineRowIndex::npos;
+        if (pos != QmTimelineRowIndex::npos) {
+            row_positions[itemRowId(item_id)].push_back(pos);
+        }
+    }
+    if (row_positions.empty()) {
+        return 0;
+    }
+
+    // 每段连续选中的item只受段前/段后第一个未选中item的限制
+    qint64 min_delta = std::numeric_limits<qint64>::min();
+    qint64 max_delta = std::numeric_limits<qint64>::max();
+    for (auto& [row_id, positions] : row_positions) {
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+        const auto* index = d_->rowIndex(row_id);
+        min_delta = qMax(min_delta, d_->view_frame_range[0] - index->startAt(positions.front()));
+        max_delta = qMin(max_delta, d_->view_frame_range[1] - index->endAt(positions.back()));
+        qsizetype run_first = positions.front();
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            if (i + 1 < positions.size() && positions[i + 1] == positions[i] + 1) {
+                continue;
             }
-            if (auto row_it = d_->item_table.find(row_id); row_it != d_->item_table.end()) {
-                if (auto origin_item_it = row_it->second.find(item_origin_it->second); origin_item_it != row_it->second.end()) {
-                    row_it->second.erase(origin_item_it);
-                    if (row_it->second.empty()) {
-                        d_->item_table.erase(row_it);
-                    }
+            if (run_first > 0) {
+                min_delta = qMax(min_delta, index->endAt(run_first - 1) + 1 - index->startAt(run_first));
+            }
+            if (positions[i] + 1 < index->size()) {
+                max_delta = qMin(max_delta, index->startAt(positions[i] + 1) - 1 - index->endAt(positions[i]));
+            }
+            if (i + 1 < positions.size()) {
+                run_first = positions[i + 1];
+            }
+        }
+    }
+    delta = qBound(qMin<qint64>(min_delta, 0), delta, qMax<qint64>(max_delta, 0));
+    if (delta == 0) {
+        return 0;
+    }
+
+    std::vector<QmItemID> moved_ids;
+    std::vector<QmTimelineItem*> moved_items;
+    for (auto& [row_id, positions] : row_positions) {
+        auto* index = d_->rowIndex(row_id);
+        // 与波纹编辑相同：已创建的item直接修改start_，尚未创建的只记录平移量
+        for (qsizetype pos : positions) {
+            QmItemID item_id = index->idAt(pos);
+            moved_ids.push_back(item_id);
+            if (auto* item = d_->items.find(item_id); item) {
+                item->start_ += delta;
+                item->setDirty(true);
+                moved_items.push_back(item);
+            } else if (auto it = d_->lazy_items.find(item_id); it != d_->lazy_items.end()) {
+                it->second.start_offset += delta;
+            }
+        }
+        index->shift(positions, delta);
+    }
+    d_->markDirty();
+    // 所有item和索引都更新之后再通知，回调中看到的是平移完成的模型
+    for (auto* item : moved_items) {
+        item->framesShifted(delta);
+        d_->invalidatePayload(item->itemId());
+    }
+    emit itemsMoved(moved_ids, delta);
+    return delta;
+}
+
+qint64 QmTimelineItemModel::rippleRow(int row_id, qint64 from_frame, qint64 delta)
+{
+    qint64 applied = ripple({ row_id }, from_frame, delta);
+    if (applied != 0) {
+        emit itemsRippled(row_id, from_frame, applied);
+    }
+    return applied;
+}
+
+qint64 QmTimelineItemModel::rippleAll(qint64 from_frame, qint64 delta)
+{
+    qint64 applied = ripple(rowIds(), from_frame, delta);
+    if (applied != 0) {
+        emit itemsRippled(-1, from_frame, applied);
+    }
+    return applied;
+}
+
+qint64 QmTimelineItemModel::ripple(const std::vector<int>& row_ids, qint64 from_frame, qint64 delta)
+{
+    if (delta == 0) {
+        return 0;
+    }
+    // 平移的是每行的一段后缀，只受后缀之前的item和可视范围限制
+    qint64 min_delta = std::numeric_limits<qint64>::min();
+    qint64 max_delta = std::numeric_limits<qint64>::max();
+    bool any_shifted = false;
+    for (int row_id : row_ids) {
+        const auto* index = d_->rowIndex(row_id);
+        if (!index) {
+            continue;
+        }
+        qsizetype first = index->lowerBound(from_frame);
+        if (first == index->size()) {
+            continue;
+        }
+        any_shifted = true;
+        qint64 limit = first > 0 ? index->endAt(first - 1) + 1 : d_->view_frame_range[0];
+        min_delta = qMax(min_delta, limit - index->startAt(first));
+        max_delta = qMin(max_delta, d_->view_frame_range[1] - index->endAt(index->size() - 1));
+    }
+    if (!any_shifted) {
+        return 0;
+    }
+    delta = qBound(qMin<qint64>(min_delta, 0), delta, qMax<qint64>(max_delta, 0));
+    if (delta == 0) {
+        return 0;
+    }
+
+    std::vector<QmTimelineItem*> shifted_items;
+    for (int row_id : row_ids) {
+        auto* index = d_->rowIndex(row_id);
+        if (!index) {
+            continue;
+        }
+        qsizetype first = index->lowerBound(from_frame);
+        // 已创建的item直接修改start_，尚未创建的只记录平移量
+        for (qsizetype pos = first; pos < index->size(); ++pos) {
+            QmItemID item_id = index->idAt(pos);
+            if (auto* item = d_->items.find(item_id); item) {
+                item->start_ += delta;
+                item->setDirty(true);
+                shifted_items.push_back(item);
+            } else if (auto it = d_->lazy_items.find(item_id); it != d_->lazy_items.end()) {
+                it->second.start_offset += delta;
+            }
+        }
+        index->shiftFrom(first, delta);
+    }
+    d_->markDirty();
+    // 所有行的索引都更新之后再通知item，子类在回调中看到的是平移完成的模型。
+    // 子类可能在回调中修改由区间推导的状态，之后再丢弃缓存的payload
+    for (auto* item : shifted_items) {
+        item->framesShifted(delta);
+        d_->invalidatePayload(item->itemId());
+    }
+    return delta;
+}
+
+void QmTimelineItemModel::removeItems(const std::vector<QmItemID>& item_ids)
+{
+    // {row_id: 要删除的item在行索引中的位置}
+    std::map<int, std::vector<qsizetype>> row_positions;
+    for (auto item_id : item_ids) {
+        const auto* index = d_->rowIndex(itemRowId(item_id));
+        qsizetype pos = index ? d_->locate(item_id, *index) : QmTimelineRowIndex::npos;
+        if (pos != QmTimelineRowIndex::npos) {
+            row_positions[itemRowId(item_id)].push_back(pos);
+        }
+    }
+    if (row_positions.empty()) {
+        return;
+    }
+
+    QmTimelineBatchScope batch(this);
+    int first_moved_row = -1;
+    for (auto& [row_id, positions] : row_positions) {
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+        d_->touchBatchRow(row_id);
+
+        const auto* index = d_->rowIndex(row_id);
+        std::vector<QmItemID> removed_ids;
+        removed_ids.reserve(positions.size());
+        // 连续删除的一段item前后两个item之间建立连接，与逐个removeItem的结果相同
+        std::vector<QmItemConnID> bridges;
+        qsizetype run_first = positions.front();
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            removed_ids.push_back(index->idAt(positions[i]));
+            if (i + 1 < positions.size() && positions[i + 1] == positions[i] + 1) {
+                continue;
+            }
+            qsizetype before = run_first - 1;
+            qsizetype after = positions[i] + 1;
+            if (before >= 0 && after < index->size()) {
+                bridges.push_back({ .from = index->idAt(before), .to = index->idAt(after) });
+            }
+            if (i + 1 < positions.size()) {
+                run_first = positions[i + 1];
+            }
+        }
+
+        for (auto item_id : removed_ids) {
+            emit itemAboutToBeRemoved(item_id);
+            removeFrameConn(item_id);
+        }
+        for (const auto& bridge : bridges) {
+            createFrameConnection(bridge.from, bridge.to);
+        }
+
+        if (auto* row_index = d_->rowIndex(row_id); row_index) {
+            row_index->erase(positions);
+            if (row_index->empty()) {
+                d_->item_table.erase(row_id);
+                if (d_->updateRowOffset(row_id) && first_moved_row < 0) {
+                    first_moved_row = row_id;
                 }
             }
-            helper_row_it->second.erase(item_origin_it);
-            if (helper_row_it->second.empty()) {
-                d_->item_table_helper.erase(helper_row_it);
+        }
+        for (auto item_id : removed_ids) {
+            if (!d_->items.erase(item_id)) {
+                d_->lazy_items.erase(item_id);
             }
+            d_->payload_cache.erase(item_id);
+            d_->batch_change.removed.push_back(item_id);
         }
     }
-    d_->items.erase(item_it);
-    if (new_head != kInvalidItemID) {
-        requestItemOperate(new_head, QmTimelineItem::OperationRole::OpUpdateAsHead);
-    } else if (new_tail != kInvalidItemID) {
-        requestItemOperate(new_head, QmTimelineItem::OperationRole::OpUpdateAsTail);
+    d_->markDirty();
+    if (first_moved_row >= 0) {
+        emit rowsYChanged(first_moved_row + 1);
     }
-    emit itemRemoved(item_id);
-    setDirty();
 }
 
 void QmTimelineItemModel::removeRow(int row_id)
 {
-    auto row_it = d_->item_table.find(row_id);
-    if (row_it != d_->item_table.end()) {
-        for (const auto& [_, item_id] : row_it->second) {
-            removeItem(item_id);
+    if (const auto* index = d_->rowIndex(row_id); index) {
+        // 整行一次删除，逐个removeItem时每次都要移动行索引中之后的元素
+        std::vector<QmItemID> item_ids;
+        item_ids.reserve(index->size());
+        for (const auto& entry : index->all()) {
+            item_ids.push_back(entry.id);
         }
-        d_->item_table.erase(row_it);
+        removeItems(item_ids);
+        d_->item_table.erase(row_id);
     }
-    d_->item_table_helper.erase(row_id);
     d_->hidden_rows.erase(row_id);
     d_->locked_rows.erase(row_id);
     d_->disabled_rows.erase(row_id);
@@ -330,7 +909,7 @@ QmItemConnID QmTimelineItemModel::createFrameConnection(QmItemID from, QmItemID
     QmItemConnID conn_id { .from = from, .to = to };
     d_->next_conns[from] = conn_id;
     d_->prev_conns[to] = conn_id;
-    emit itemConnCreated(conn_id);
+    notifyItemConnCreated(conn_id);
     return conn_id;
 }
 
@@ -352,7 +931,7 @@ void QmTimelineItemModel::removeFrameNextConn(QmItemID item_id)
     if (prev_it != d_->prev_conns.end()) {
         d_->prev_conns.erase(prev_it);
     }
-    emit itemConnRemoved(conn_id);
+    notifyItemConnRemoved(conn_id);
 }
 
 void QmTimelineItemModel::removeFramePrevConn(QmItemID item_id)
@@ -367,7 +946,7 @@ void QmTimelineItemModel::removeFramePrevConn(QmItemID item_id)
     if (prev_it != d_->next_conns.end()) {
         d_->next_conns.erase(prev_it);
     }
-    emit itemConnRemoved(conn_id);
+    notifyItemConnRemoved(conn_id);
 }
 
 bool QmTimelineItemModel::setItemProperty(QmItemID item_id, int role, const QVariant& data)
@@ -411,32 +990,43 @@ void QmTimelineItemModel::setRowHidden(int row, bool hidden)
         d_->hidden_rows.erase(row);
     }
 
-    auto it = d_->item_table.find(row);
-    if (it == d_->item_table.end()) {
-        it = d_->item_table.upper_bound(row);
-    }
-    for (; it != d_->item_table.end(); ++it) {
-        for (const auto& [_, item_id] : it->second) {
-            emit requestUpdateItemY(item_id);
-        }
-    }
+    // 该行自身的item在隐藏时移出可视区域，因此从该行开始刷新
+    d_->updateRowOffset(row);
+    emit rowsYChanged(row);
     setDirty();
 }
 
 bool QmTimelineItemModel::isDirty() const
 {
-    return d_->dirty || std::any_of(d_->items.cbegin(), d_->items.cend(), [](const auto& pair) { return pair.second->isDirty(); });
+    return d_->dirty || d_->items.anyOf([](QmItemID, const QmTimelineItem* item) { return item->isDirty(); });
 }
 
 void QmTimelineItemModel::setDirty(bool dirty)
 {
     d_->dirty = dirty;
+    if (dirty) {
+        ++d_->revision;
+    }
 }
 
 void QmTimelineItemModel::resetDirty()
 {
     d_->dirty = false;
-    std::for_each(d_->items.begin(), d_->items.end(), [](const auto& pair) { pair.second->resetDirty(); });
+    d_->items.forEach([](QmItemID, QmTimelineItem* item) { item->resetDirty(); });
+}
+
+bool QmTimelineItemModel::resetDirty(quint64 revision)
+{
+    if (revision != d_->revision) {
+        return false;
+    }
+    resetDirty();
+    return true;
+}
+
+quint64 QmTimelineItemModel::revision() const
+{
+    return d_->revision;
 }
 
 bool QmTimelineItemModel::isRowHidden(int row) const
@@ -491,15 +1081,14 @@ bool QmTimelineItemModel::isItemDisabled(QmItemID item_id) const
 void QmTimelineItemModel::setRowHeight(int row_id, qreal height)
 {
     d_->row_heights[row_id] = height;
+    if (d_->updateRowOffset(row_id)) {
+        emit rowsYChanged(row_id + 1);
+    }
 }
 
 qreal QmTimelineItemModel::rowHeight(int row_id) const
 {
-    auto it = d_->row_heights.find(row_id);
-    if (it == d_->row_heights.end()) {
-        return d_->default_item_height;
-    }
-    return it->second;
+    return d_->rowHeight(row_id);
 }
 
 qreal QmTimelineItemModel::itemHeight(QmItemID item_id) const
@@ -520,16 +1109,18 @@ void QmTimelineItemModel::setRowDisabled(int row, bool disabled)
 
 int QmTimelineItemModel::rowItemCount(int row) const
 {
-    auto it = d_->item_table.find(row);
-    if (it == d_->item_table.end()) {
+    const auto* index = d_->rowIndex(row);
+    if (!index) {
         return 0;
     }
-    return it->second.size();
+    return index->size();
 }
 
 void QmTimelineItemModel::setDefaultItemHeight(qreal height)
 {
     d_->default_item_height = height;
+    d_->rebuildRowOffsets();
+    emit rowsYChanged(0);
 }
 
 qreal QmTimelineItemModel::defaultItemHeight() const
@@ -557,34 +1148,25 @@ qreal QmTimelineItemModel::itemY(QmItemID item_id) const
     if (d_->item_y_calculator) {
         return d_->item_y_calculator(item_id);
     }
-
-    qreal y = 0;
-
-    for (auto it = d_->item_table.begin(); it != row_it; ++it) {
-        if (isRowHidden(it->first)) {
-            continue;
-        }
-        y += rowHeight(it->first);
-    }
-    return y;
+    return d_->row_offsets.offset(row_id);
 }
 
 QmItemID QmTimelineItemModel::headItem(int row) const
 {
-    auto it = d_->item_table.find(row);
-    if (it == d_->item_table.end() || it->second.empty()) {
+    const auto* index = d_->rowIndex(row);
+    if (!index || index->empty()) {
         return kInvalidItemID;
     }
-    return it->second.begin()->second;
+    return index->idAt(0);
 }
 
 QmItemID QmTimelineItemModel::tailItem(int row) const
 {
-    auto it = d_->item_table.find(row);
-    if (it == d_->item_table.end() || it->second.empty()) {
+    const auto* index = d_->rowIndex(row);
+    if (!index || index->empty()) {
         return kInvalidItemID;
     }
-    return std::prev(it->second.end())->second;
+    return index->idAt(index->size() - 1);
 }
 
 QmItemID QmTimelineItemModel::previousItem(QmItemID item_id) const
@@ -592,79 +1174,292 @@ QmItemID QmTimelineItemModel::previousItem(QmItemID item_id) const
     if (item_id == kInvalidItemID) {
         return kInvalidItemID;
     }
-    int row_id = itemRowId(item_id);
-    if (row_id < 0) {
+    const auto* index = d_->rowIndex(itemRowId(item_id));
+    if (!index) {
         return kInvalidItemID;
     }
-
-    auto helper_row_it = d_->item_table_helper.find(row_id);
-    if (helper_row_it == d_->item_table_helper.end()) {
+    qsizetype pos = d_->locate(item_id, *index);
+    if (pos == QmTimelineRowIndex::npos || pos == 0) {
         return kInvalidItemID;
     }
-    auto start_it = helper_row_it->second.find(item_id);
-    if (start_it == helper_row_it->second.end()) {
+    return index->idAt(pos - 1);
+}
+
+QmItemID QmTimelineItemModel::nextItem(QmItemID item_id) const
+{
+    if (item_id == kInvalidItemID) {
         return kInvalidItemID;
     }
-    auto row_it = d_->item_table.find(row_id);
-    if (row_it == d_->item_table.end()) {
+    const auto* index = d_->rowIndex(itemRowId(item_id));
+    if (!index) {
         return kInvalidItemID;
     }
-    auto item_it = row_it->second.find(start_it->second);
-    if (item_it == row_it->second.end() || item_it == row_it->second.begin()) {
+    qsizetype pos = d_->locate(item_id, *index);
+    if (pos == QmTimelineRowIndex::npos || pos + 1 >= index->size()) {
         return kInvalidItemID;
     }
-    auto prev_it = std::prev(item_it);
-    return prev_it->second;
+    return index->idAt(pos + 1);
 }
 
-QmItemID QmTimelineItemModel::nextItem(QmItemID item_id) const
+int QmTimelineItemModel::itemNumber(QmItemID item_id) const
 {
     if (item_id == kInvalidItemID) {
-        return kInvalidItemID;
+        return 0;
+    }
+    const auto* index = d_->rowIndex(itemRowId(item_id));
+    if (!index) {
+        return 0;
     }
+    qsizetype pos = d_->locate(item_id, *index);
+    if (pos == QmTimelineRowIndex::npos) {
+        return 0;
+    }
+    return static_cast<int>(pos + 1);
+}
+
+void QmTimelineItemModel::notifyRowNumbersChanged(int row_id, qsizetype first_pos)
+{
+    emit rowNumbersChanged(row_id, static_cast<int>(first_pos + 1));
+
+    // 只通知可视范围内受影响的item，其余item在进入可视范围时重绘即可取到新的序号
+    const auto* index = d_->rowIndex(row_id);
+    if (!index) {
+        return;
+    }
+    qsizetype first = qMax(first_pos, index->lowerBoundEnd(d_->view_frame_range[0]));
+    qsizetype last = index->upperBound(d_->view_frame_range[1]);
+    for (qsizetype pos = first; pos < last; ++pos) {
+        emit itemChanged(index->idAt(pos), QmTimelineItem::NumberRole);
+    }
+}
+
+void QmTimelineItemModel::notifyItemInserted(QmItemID item_id)
+{
+    if (d_->batch_depth > 0) {
+        d_->batch_change.created.push_back(item_id);
+        return;
+    }
+
     int row_id = itemRowId(item_id);
-    if (row_id < 0) {
-        return kInvalidItemID;
+    const auto* index = d_->rowIndex(row_id);
+    qsizetype pos = index ? d_->locate(item_id, *index) : QmTimelineRowIndex::npos;
+    if (pos == QmTimelineRowIndex::npos) {
+        return;
     }
+    // 新item成为头/尾时，原来的头/尾也需要刷新
+    qsizetype row_size = index->size();
+    QmItemID old_head = (pos == 0 && row_size > 1) ? index->idAt(1) : kInvalidItemID;
+    QmItemID old_tail = (pos > 0 && pos == row_size - 1) ? index->idAt(pos - 1) : kInvalidItemID;
 
-    auto helper_row_it = d_->item_table_helper.find(row_id);
-    if (helper_row_it == d_->item_table_helper.end()) {
-        return kInvalidItemID;
+    emit itemCreated(item_id);
+    if (pos + 1 < row_size) {
+        notifyRowNumbersChanged(row_id, pos + 1);
     }
-    auto origin_it = helper_row_it->second.find(item_id);
-    if (origin_it == helper_row_it->second.end()) {
-        return kInvalidItemID;
+
+    if (pos == 0) {
+        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsHead);
+    } else if (pos == row_size - 1) {
+        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsTail);
     }
-    auto row_it = d_->item_table.find(row_id);
-    if (row_it == d_->item_table.end()) {
-        return kInvalidItemID;
+
+    if (old_head != kInvalidItemID) {
+        requestItemOperate(old_head, QmTimelineItem::OperationRole::OpUpdateAsHead);
+    } else if (old_tail != kInvalidItemID) {
+        requestItemOperate(old_tail, QmTimelineItem::OperationRole::OpUpdateAsTail);
+    }
+}
+
+void QmTimelineItemModel::notifyItemConnCreated(const QmItemConnID& conn_id)
+{
+    d_->resetConnsSnapshot();
+    ++d_->revision;
+    if (d_->batch_depth > 0) {
+        d_->batch_change.conn_created.push_back(conn_id);
+        return;
+    }
+    emit itemConnCreated(conn_id);
+}
+
+void QmTimelineItemModel::notifyItemConnRemoved(const QmItemConnID& conn_id)
+{
+    d_->resetConnsSnapshot();
+    ++d_->revision;
+    if (d_->batch_depth > 0) {
+        d_->batch_change.conn_removed.push_back(conn_id);
+        return;
+    }
+    emit itemConnRemoved(conn_id);
+}
+
+void QmTimelineItemModel::beginBatch()
+{
+    ++d_->batch_depth;
+}
+
+bool QmTimelineItemModel::isInBatch() const
+{
+    return d_->batch_depth > 0;
+}
+
+void QmTimelineItemModel::endBatch()
+{
+    if (d_->batch_depth == 0) {
+        QMTL_LOG_WARN("endBatch() called without a matching beginBatch().");
+        return;
+    }
+    if (--d_->batch_depth > 0) {
+        return;
+    }
+
+    auto change = std::exchange(d_->batch_change, {});
+    auto rows = std::exchange(d_->batch_rows, {});
+
+    // 只通知净变化：批量期间创建后又删除的item/连接不再出现，删除后又重新创建的按新建处理，由场景替换旧的视图
+    std::unordered_set<QmItemID> created_ids(change.created.cbegin(), change.created.cend());
+    std::erase_if(change.removed, [this, &created_ids](QmItemID item_id) { return exists(item_id) || created_ids.contains(item_id); });
+    std::erase_if(change.created, [this](QmItemID item_id) { return !exists(item_id); });
+    std::sort(change.created.begin(), change.created.end());
+    change.created.erase(std::unique(change.created.begin(), change.created.end()), change.created.end());
+
+    std::unordered_set<QmItemConnID, QmItemConnIDHash, QmItemConnIDEqual> created_conns(change.conn_created.cbegin(), change.conn_created.cend());
+    std::erase_if(change.conn_removed,
+        [this, &created_conns](const QmItemConnID& conn_id) { return d_->isConnAlive(conn_id) || created_conns.contains(conn_id); });
+    change.conn_created.clear();
+    for (const auto& conn_id : created_conns) {
+        if (d_->isConnAlive(conn_id)) {
+            change.conn_created.push_back(conn_id);
+        }
+    }
+
+    change.rows.reserve(rows.size());
+    for (const auto& [row_id, _] : rows) {
+        change.rows.push_back(row_id);
+    }
+    if (change.isEmpty()) {
+        return;
+    }
+    emit itemsBatchChanged(change);
+
+    // 每行只刷新一次头尾及序号
+    for (const auto& [row_id, old_ends] : rows) {
+        QmItemID head = headItem(row_id);
+        QmItemID tail = tailItem(row_id);
+        if (head != kInvalidItemID) {
+            requestItemOperate(head, QmTimelineItem::OperationRole::OpUpdateAsHead);
+        }
+        if (old_ends.first != head) {
+            requestItemOperate(old_ends.first, QmTimelineItem::OperationRole::OpUpdateAsHead);
+        }
+        if (tail != kInvalidItemID && tail != head) {
+            requestItemOperate(tail, QmTimelineItem::OperationRole::OpUpdateAsTail);
+        }
+        if (old_ends.second != tail && old_ends.second != old_ends.first) {
+            requestItemOperate(old_ends.second, QmTimelineItem::OperationRole::OpUpdateAsTail);
+        }
+        if (head != kInvalidItemID) {
+            notifyRowNumbersChanged(row_id, 0);
+        }
+    }
+}
+
+std::map<qint64, QmItemID> QmTimelineItemModel::rowItems(int row) const
+{
+    std::map<qint64, QmItemID> result;
+    const auto* index = d_->rowIndex(row);
+    if (!index) {
+        return result;
+    }
+    for (qsizetype pos = 0; pos < index->size(); ++pos) {
+        result.emplace_hint(result.end(), index->startAt(pos), index->idAt(pos));
+    }
+    return result;
+}
+
+QmTimelineRowRange QmTimelineItemModel::itemsInRange(int row_id, qint64 from_frame, qint64 to_frame) const
+{
+    const auto* index = d_->rowIndex(row_id);
+    if (!index) {
+        return {};
     }
-    auto item_it = row_it->second.find(origin_it->second);
-    if (item_it == row_it->second.end()) {
-        return kInvalidItemID;
+    return index->overlapping(from_frame, to_frame);
+}
+
+void QmTimelineItemModel::itemsInRange(qint64 from_frame, qint64 to_frame, std::vector<QmTimelineRowSlice>& out) const
+{
+    out.clear();
+    for (const auto& [row_id, index] : d_->item_table) {
+        auto range = index.overlapping(from_frame, to_frame);
+        if (!range.empty()) {
+            out.push_back({ row_id, range });
+        }
     }
+}
 
-    auto next_it = std::next(item_it);
-    if (next_it == row_it->second.end()) {
-        return kInvalidItemID;
+qsizetype QmTimelineItemModel::itemsAt(qint64 frame, std::vector<QmItemID>& out) const
+{
+    out.clear();
+    for (const auto& [_, index] : d_->item_table) {
+        qsizetype pos = index.stab(frame);
+        if (pos != QmTimelineRowIndex::npos) {
+            out.push_back(index.idAt(pos));
+        }
     }
-    return next_it->second;
+    return static_cast<qsizetype>(out.size());
 }
 
-std::map<qint64, QmItemID> QmTimelineItemModel::rowItems(int row) const
+qsizetype QmTimelineItemModel::itemsOverlapping(qint64 from_frame, qint64 to_frame, std::vector<QmItemID>& out) const
 {
-    auto row_it = d_->item_table.find(row);
-    if (row_it == d_->item_table.end()) {
-        return {};
+    out.clear();
+    for (const auto& [_, index] : d_->item_table) {
+        auto ids = index.overlapping(from_frame, to_frame).ids();
+        out.insert(out.end(), ids.begin(), ids.end());
+    }
+    return static_cast<qsizetype>(out.size());
+}
+
+QmTimelineModelSnapshot QmTimelineItemModel::snapshot() const
+{
+    d_->ensureConnsSnapshot();
+    auto data = std::make_shared<QmTimelineModelSnapshotData>();
+    data->rows = d_->item_table;
+    data->hidden_rows = d_->hidden_rows;
+    data->locked_rows = d_->locked_rows;
+    data->disabled_rows = d_->disabled_rows;
+    data->next_conns = d_->next_conns_snapshot;
+    data->prev_conns = d_->prev_conns_snapshot;
+    data->frame_range = d_->frame_range;
+    data->view_frame_range = d_->view_frame_range;
+    data->fps = d_->fps;
+    data->item_count = d_->items.size() + static_cast<qsizetype>(d_->lazy_items.size());
+    return QmTimelineModelSnapshot(std::move(data));
+}
+
+const QmTimelineRowIndex* QmTimelineItemModel::rowIndex(int row_id) const
+{
+    return d_->rowIndex(row_id);
+}
+
+std::vector<int> QmTimelineItemModel::rowIds() const
+{
+    std::vector<int> row_ids;
+    row_ids.reserve(d_->item_table.size());
+    for (const auto& [row_id, _] : d_->item_table) {
+        row_ids.push_back(row_id);
     }
-    return row_it->second;
+    return row_ids;
 }
 
 void QmTimelineItemModel::notifyItemPropertyChanged(QmItemID item_id, int role, const QVariant& old_value)
 {
-    if (!d_->items.contains(item_id)) {
+    auto* item = d_->items.find(item_id);
+    if (!item) {
         return;
     }
+    d_->invalidatePayload(item_id);
+    ++d_->revision;
+    if (role & (QmTimelineItem::StartRole | QmTimelineItem::DurationRole)) {
+        d_->syncItemIndex(*item, (role & QmTimelineItem::StartRole) ? old_value : QVariant());
+    }
     emit itemChanged(item_id, role, old_value);
 }
 
@@ -713,13 +1508,13 @@ bool QmTimelineItemModel::isFrameInRange(qint64 start, qint64 duration) const
 
 bool QmTimelineItemModel::isItemInViewRange(QmItemID item_id) const
 {
-    auto* item = this->item(item_id);
-    if (!item) {
+    qint64 start = 0;
+    qint64 end = 0;
+    if (!d_->itemSpan(item_id, start, end)) {
         return false;
     }
 
-    return (item->start() >= d_->view_frame_range[0] && item->start() <= d_->view_frame_range[1])
-        || (item->start() + item->duration() >= d_->view_frame_range[0]);
+    return (start >= d_->view_frame_range[0] && start <= d_->view_frame_range[1]) || (end >= d_->view_frame_range[0]);
 }
 
 bool QmTimelineItemModel::modifyItemStart(QmItemID item_id, qint64 start)
@@ -731,17 +1526,18 @@ bool QmTimelineItemModel::modifyItemStart(QmItemID item_id, qint64 start)
     if (item->start() == start) {
         return false;
     }
-    if (auto prev_item_id = previousItem(item_id); prev_item_id != kInvalidItemID) {
-        auto* prev_item = this->item(prev_item_id);
-        if (prev_item != nullptr && prev_item->start() + prev_item->duration() >= start) {
-            start = prev_item->start() + prev_item->duration() + 1;
+    // 相邻item只需要区间，不必创建
+    qint64 neighbor_start = 0;
+    qint64 neighbor_end = 0;
+    if (auto prev_item_id = previousItem(item_id); d_->itemSpan(prev_item_id, neighbor_start, neighbor_end)) {
+        if (neighbor_end >= start) {
+            start = neighbor_end + 1;
         }
     }
 
-    if (auto next_item_id = nextItem(item_id); next_item_id != kInvalidItemID) {
-        auto* next_item = this->item(next_item_id);
-        if (next_item != nullptr && next_item->start() <= start + item->duration()) {
-            start = next_item->start() - item->duration() - 1;
+    if (auto next_item_id = nextItem(item_id); d_->itemSpan(next_item_id, neighbor_start, neighbor_end)) {
+        if (neighbor_start <= start + item->duration()) {
+            start = neighbor_start - item->duration() - 1;
         }
     }
 
@@ -749,23 +1545,16 @@ bool QmTimelineItemModel::modifyItemStart(QmItemID item_id, qint64 start)
         return false;
     }
 
-    int row_id = itemRowId(item_id);
-    auto row_it = d_->item_table.find(row_id);
-    if (row_it == d_->item_table.end()) [[unlikely]] {
+    auto* index = d_->rowIndex(itemRowId(item_id));
+    if (!index) [[unlikely]] {
         return false;
     }
 
-    auto helper_row_it = d_->item_table_helper.find(row_id);
-    if (helper_row_it == d_->item_table_helper.end()) [[unlikely]] {
+    qsizetype pos = d_->locate(item_id, *index);
+    if (pos == QmTimelineRowIndex::npos) [[unlikely]] {
         return false;
     }
-
-    auto start_it = row_it->second.find(item->start());
-    if (start_it != row_it->second.end()) {
-        row_it->second.erase(start_it);
-    }
-    row_it->second[start] = item_id;
-    helper_row_it->second[item_id] = start;
+    index->move(pos, start, start + item->duration());
 
     item->setStart(start);
     return true;
@@ -786,6 +1575,85 @@ double QmTimelineItemModel::fps() const
     return d_->fps;
 }
 
+bool QmTimelineItemModel::convertFps(double fps, QmFrameRounding rounding)
+{
+    if (fps <= 0 || d_->fps <= 0) {
+        QMTL_LOG_WARN("Invalid fps conversion: {} -> {}", d_->fps, fps);
+        return false;
+    }
+    if (qFuzzyCompare(d_->fps, fps)) {
+        return true;
+    }
+    const double ratio = fps / d_->fps;
+
+    struct RowResult {
+        QmTimelineRowIndex* index { nullptr };
+        std::vector<qint64> starts;
+        std::vector<qint64> ends;
+    };
+    std::vector<RowResult> results;
+    results.reserve(d_->item_table.size());
+    for (auto& [_, index] : d_->item_table) {
+        results.push_back({ .index = &index });
+    }
+
+    // 行之间互不影响，每行一个任务；任务只读行索引，结果写入各自的RowResult。
+    // 使用私有的线程池：全局线程池可能被宿主程序占满，在其中的线程调用时还会互相等待
+    QThreadPool pool;
+    for (auto& result : results) {
+        pool.start([&result, ratio, rounding] {
+            const auto& index = *result.index;
+            auto range = index.all();
+            scaleFrames(range.starts(), 0, ratio, rounding, result.starts);
+            scaleFrames(range.ends(), 1, ratio, rounding, result.ends);
+            resolveCollisions(result.starts, result.ends);
+        });
+    }
+    pool.waitForDone();
+
+    qint64 max_end = std::numeric_limits<qint64>::min();
+    std::vector<QmTimelineItem*> retimed_items;
+    for (auto& result : results) {
+        auto& index = *result.index;
+        for (qsizetype pos = 0; pos < index.size(); ++pos) {
+            QmItemID item_id = index.idAt(pos);
+            qint64 start = result.starts[pos];
+            qint64 duration = result.ends[pos] - start;
+            if (auto* item = d_->items.find(item_id); item) {
+                item->start_ = start;
+                item->duration_ = duration;
+                item->setDirty(true);
+                retimed_items.push_back(item);
+            } else if (auto it = d_->lazy_items.find(item_id); it != d_->lazy_items.end()) {
+                it->second.start_offset += start - index.startAt(pos);
+                it->second.duration_offset += duration - (index.endAt(pos) - index.startAt(pos));
+            }
+        }
+        if (!result.ends.empty()) {
+            max_end = qMax(max_end, result.ends.back());
+        }
+        index.assignSpans(std::move(result.starts), std::move(result.ends));
+    }
+
+    // 范围向外舍入，并且包含后推之后的item
+    auto scale_range = [ratio, max_end](std::array<qint64, 2>& range) {
+        range[0] = roundFrame<QmFrameRounding::Floor>(static_cast<double>(range[0]) * ratio);
+        range[1] = qMax(roundFrame<QmFrameRounding::Ceil>(static_cast<double>(range[1]) * ratio), max_end);
+    };
+    scale_range(d_->frame_range);
+    scale_range(d_->view_frame_range);
+
+    d_->fps = fps;
+    d_->markDirty();
+    for (auto* item : retimed_items) {
+        item->framesRescaled(ratio);
+        d_->invalidatePayload(item->itemId());
+    }
+    notifyRangesChanged();
+    emit itemsRetimed(fps);
+    return true;
+}
+
 void QmTimelineItemModel::setViewFrameMaximum(qint64 maximum)
 {
     if (maximum == d_->view_frame_range[1] || maximum < d_->view_frame_range[0] + 1) {
@@ -818,17 +1686,30 @@ qint64 QmTimelineItemModel::viewFrameMaximum() const
 
 void QmTimelineItemModel::clear()
 {
-    std::set<QmItemID> item_ids;
-    std::transform(d_->items.cbegin(), d_->items.cend(), std::inserter(item_ids, item_ids.begin()), [](const auto& pair) { return pair.first; });
-    for (const auto& item_id : item_ids) {
-        removeItem(item_id);
+    // 所有行在一次批量编辑中整行删除，逐个removeItem时每次都要移动行索引中之后的元素并建立前后连接
+    std::vector<QmItemID> item_ids;
+    item_ids.reserve(d_->items.size() + d_->lazy_items.size());
+    for (const auto& [row_id, index] : d_->item_table) {
+        for (const auto& entry : index.all()) {
+            item_ids.push_back(entry.id);
+        }
     }
-    d_->id_index = 0;
+    removeItems(item_ids);
+    d_->items.clear();
+    d_->item_table.clear();
+    d_->next_conns.clear();
+    d_->prev_conns.clear();
+    d_->resetConnsSnapshot();
+    d_->payload_cache.clear();
+    d_->payload_misses.clear();
+    d_->closeMapping();
+    // id_index不重置，清空前发出的id(撤销栈、场景、外部保存的引用)不会指向之后新建的item
     d_->dirty = false;
     d_->hidden_rows.clear();
     d_->locked_rows.clear();
     d_->disabled_rows.clear();
     d_->row_heights.clear();
+    d_->rebuildRowOffsets();
 }
 
 qint64 QmTimelineItemModel::frameToTime(qint64 frame_no) const
@@ -855,11 +1736,27 @@ void QmTimelineItemModel::setItemYCalculator(const std::function<qreal(QmItemID)
 
 nlohmann::json QmTimelineItemModel::save() const
 {
+    // JSON需要每个item的完整数据
+    materializeAll();
     nlohmann::json j;
 
+    // item_table/item_table_helper由items推导而来，加载时不再读取，保存它们只是为了兼容旧版本
+    nlohmann::json item_table_j = nlohmann::json::array();
+    nlohmann::json item_table_helper_j = nlohmann::json::array();
+    for (const auto& [row_id, index] : d_->item_table) {
+        nlohmann::json row_j = nlohmann::json::array();
+        nlohmann::json helper_row_j = nlohmann::json::array();
+        for (qsizetype pos = 0; pos < index.size(); ++pos) {
+            row_j.push_back({ index.startAt(pos), index.idAt(pos) });
+            helper_row_j.push_back({ index.idAt(pos), index.startAt(pos) });
+        }
+        item_table_j.push_back({ row_id, std::move(row_j) });
+        item_table_helper_j.push_back({ row_id, std::move(helper_row_j) });
+    }
+
     j["id_index"] = d_->id_index;
-    j["item_table"] = d_->item_table;
-    j["item_table_helper"] = d_->item_table_helper;
+    j["item_table"] = std::move(item_table_j);
+    j["item_table_helper"] = std::move(item_table_helper_j);
     j["hidden_rows"] = d_->hidden_rows;
     j["locked_rows"] = d_->locked_rows;
     j["disabled_rows"] = d_->disabled_rows;
@@ -867,12 +1764,12 @@ nlohmann::json QmTimelineItemModel::save() const
     j["view_frame_range"] = d_->view_frame_range;
 
     nlohmann::json items_j;
-    for (const auto& [item_id, item_ptr] : d_->items) {
+    d_->items.forEach([&items_j](QmItemID item_id, const QmTimelineItem* item) {
         nlohmann::json item_j;
         item_j["id"] = item_id;
-        item_j["data"] = item_ptr->save();
+        item_j["data"] = item->save();
         items_j.emplace_back(item_j);
-    }
+    });
     j["items"] = items_j;
 
     nlohmann::json prev_conns_j;
@@ -895,6 +1792,350 @@ nlohmann::json QmTimelineItemModel::save() const
     return j;
 }
 
+bool QmTimelineItemModel::loadStream(QIODevice& device)
+{
+    try {
+        clear();
+        std::vector<QmItemConnID> conns;
+        QmTimelineJsonStreamReader reader;
+        // item_table/item_table_helper由items推导而来，prev_conns是next_conns的镜像，均不需要读取
+        reader.setSkippedKeys({ "item_table", "item_table_helper", "prev_conns" });
+        reader.setArrayHandler("next_conns", [&conns](nlohmann::json&& conn_item_j) { conns.push_back(conn_item_j.at("connection").get<QmItemConnID>()); });
+        reader.setArrayHandler("items", [this](nlohmann::json&& item_j) { notifyItemInserted(appendLoadedItem(item_j)); });
+
+        {
+            QmTimelineBatchScope batch(this);
+            try {
+                if (!reader.read(device)) {
+                    throw std::exception(reader.errorString().toStdString().c_str());
+                }
+                loadProperties(reader.properties());
+                for (auto& [_, index] : d_->item_table) {
+                    index.sort();
+                }
+                d_->validateLoadedRows(reader.properties().at("id_index").get<QmItemID>());
+                d_->rebuildRowOffsets();
+                for (const auto& conn_id : conns) {
+                    if (!exists(conn_id.from) || !exists(conn_id.to)) {
+                        continue;
+                    }
+                    d_->next_conns[conn_id.from] = conn_id;
+                    d_->prev_conns[conn_id.to] = conn_id;
+                    notifyItemConnCreated(conn_id);
+                }
+            } catch (...) {
+                // 与loadBinaryData相同，在批量编辑结束之前排序并清空
+                for (auto& [_, index] : d_->item_table) {
+                    index.sort();
+                }
+                clear();
+                throw;
+            }
+        }
+        notifyRangesChanged();
+        return true;
+    } catch (const std::exception& excep) {
+        QMTL_LOG_ERROR("Failed to load item stream. Exception: {}", excep.what());
+    }
+    return false;
+}
+
+bool QmTimelineItemModel::loadBinary(QIODevice& device)
+{
+    try {
+        clear();
+        QByteArray data = device.readAll();
+        loadBinaryData(data.constData(), data.size(), false);
+        return true;
+    } catch (const std::exception& excep) {
+        QMTL_LOG_ERROR("Failed to load binary snapshot. Exception: {}", excep.what());
+    }
+    return false;
+}
+
+bool QmTimelineItemModel::saveBinary(QIODevice& device) const
+{
+    if (!device.isWritable()) {
+        QMTL_LOG_ERROR("Failed to save binary snapshot. The device is not writable.");
+        return false;
+    }
+    if (auto* file = qobject_cast<QFile*>(&device); file && d_->isMappedFile(file->fileName())) {
+        QMTL_LOG_ERROR("Failed to save binary snapshot. The target is the mapped file, use saveBinary(file_path) instead.");
+        return false;
+    }
+
+    QDataStream stream(&device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    if (!QmTimelineBinaryFormat::writeImage(stream, binaryImage())) {
+        QMTL_LOG_ERROR("Failed to save binary snapshot. Write error.");
+        return false;
+    }
+    return true;
+}
+
+bool QmTimelineItemModel::saveBinary(const QString& file_path)
+{
+    // 截断或替换映射的文件之前，尚未创建的item的payload必须已经复制出来
+    if (d_->isMappedFile(file_path)) {
+        d_->detachMapping();
+    }
+    QSaveFile file(file_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMTL_LOG_ERROR("Failed to save binary snapshot to {}. {}", file_path.toStdString(), file.errorString().toStdString());
+        return false;
+    }
+    if (!saveBinary(file)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        QMTL_LOG_ERROR("Failed to save binary snapshot to {}. {}", file_path.toStdString(), file.errorString().toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool QmTimelineItemModel::encodePayloads(qsizetype max_items)
+{
+    return d_->encodePayloads(max_items);
+}
+
+QmTimelineBinaryImage QmTimelineItemModel::binaryImage() const
+{
+    // GUI线程只编码剩余的payload并复制引用：行索引O(行数)，payload缓存O(桶数)。
+    // item记录的建立和按id排序由writeImage完成，自动保存时在保存线程中执行
+    d_->encodePayloads(std::numeric_limits<qsizetype>::max());
+
+    QmTimelineBinaryImage image;
+    image.id_index = d_->id_index;
+    image.frame_range = d_->frame_range;
+    image.view_frame_range = d_->view_frame_range;
+    image.fps = d_->fps;
+    image.states = { d_->hidden_rows, d_->locked_rows, d_->disabled_rows };
+    image.rows = d_->item_table;
+    image.item_count = d_->items.size() + static_cast<qsizetype>(d_->lazy_items.size());
+    image.payloads = d_->payload_cache;
+
+    d_->ensureConnsSnapshot();
+    image.conns = d_->next_conns_snapshot;
+    if (!d_->lazy_items.empty()) {
+        // 未创建的item没有被修改过，直接引用映射中的记录和payload
+        image.mapped_file = d_->mapped_file;
+        image.mapped_buffer = d_->mapped_buffer;
+        image.mapped_data = d_->mapped_data;
+        image.mapped_header = d_->mapped_header;
+    }
+    return image;
+}
+
+void QmTimelineItemModel::loadBinaryData(const char* data, qsizetype size, bool lazy)
+{
+    QmTimelineBinaryHeader header;
+    if (!QmTimelineBinaryFormat::readHeader(data, size, header) || header.rows_offset > header.items_offset) {
+        throw std::exception("invalid binary snapshot header!");
+    }
+    QmTimelineBinaryRowStates states;
+    if (!QmTimelineBinaryFormat::readRowStates(data + header.rows_offset, header.items_offset - header.rows_offset, states)) {
+        throw std::exception("invalid binary snapshot row states!");
+    }
+    if (lazy) {
+        d_->mapped_header = header;
+    }
+
+    d_->id_index = qMax(d_->id_index, header.id_index);
+    d_->frame_range = header.frame_range;
+    d_->view_frame_range = header.view_frame_range;
+    d_->fps = header.fps;
+    d_->hidden_rows = std::move(states.hidden_rows);
+    d_->locked_rows = std::move(states.locked_rows);
+    d_->disabled_rows = std::move(states.disabled_rows);
+
+    {
+        // 与from_json相同，先登记所有item再整体排序建立行索引，批量结束时一次性通知
+        QmTimelineBatchScope batch(this);
+        try {
+            const char* payloads = data + header.payload_offset;
+            for (quint64 i = 0; i < header.item_count; ++i) {
+                auto record = QmTimelineBinaryFormat::readItemRecord(data + header.items_offset + i * QmTimelineBinaryFormat::kItemRecordSize);
+                if (record.payload_offset > header.payload_size || record.payload_size > header.payload_size - record.payload_offset) {
+                    throw std::exception(std::format("invalid payload of item[{}]!", record.id).c_str());
+                }
+                if (record.duration < 0) {
+                    throw std::exception(std::format("invalid duration of item[{}]!", record.id).c_str());
+                }
+                if (exists(record.id)) {
+                    throw std::exception(std::format("duplicate item[{}]!", record.id).c_str());
+                }
+
+                int row_id = itemRowId(record.id);
+                d_->touchBatchRow(row_id);
+                d_->item_table[row_id].append(record.id, record.start, record.start + record.duration);
+                if (lazy) {
+                    // 只登记记录位置，item在第一次访问时才创建
+                    d_->lazy_items.emplace(record.id, QmTimelineItemModelPrivate::LazyItem { i, 0 });
+                } else {
+                    QByteArrayView payload(payloads + record.payload_offset, record.payload_size);
+                    auto item = createRecordItem(record, payload);
+                    if (!item) {
+                        throw std::exception(std::format("load item[{}] failed!", record.id).c_str());
+                    }
+                    d_->items.insert(record.id, std::move(item));
+                    d_->cachePayload(record.id, payload, record.flags);
+                }
+                notifyItemInserted(record.id);
+            }
+            for (auto& [_, index] : d_->item_table) {
+                index.sort();
+            }
+            d_->validateLoadedRows(header.id_index);
+            d_->rebuildRowOffsets();
+
+            for (quint64 i = 0; i < header.conn_count; ++i) {
+                auto conn_id = QmTimelineBinaryFormat::readConnRecord(data + header.conns_offset + i * QmTimelineBinaryFormat::kConnRecordSize);
+                if (!exists(conn_id.from) || !exists(conn_id.to)) {
+                    continue;
+                }
+                d_->next_conns[conn_id.from] = conn_id;
+                d_->prev_conns[conn_id.to] = conn_id;
+                notifyItemConnCreated(conn_id);
+            }
+        } catch (...) {
+            // 在批量编辑结束之前清空，结束时不会通知加载了一半的item，映射也随之关闭。
+            // 追加的区间可能还没有排序，先排序，清空时才能按区间定位
+            for (auto& [_, index] : d_->item_table) {
+                index.sort();
+            }
+            clear();
+            throw;
+        }
+    }
+
+    notifyRangesChanged();
+}
+
+bool QmTimelineItemModel::loadMapped(const QString& file_path)
+{
+    try {
+        clear();
+        auto file = std::make_unique<QFile>(file_path);
+        if (!file->open(QIODevice::ReadOnly)) {
+            throw std::exception(std::format("open file failed! {}", file->errorString().toStdString()).c_str());
+        }
+        uchar* data = file->map(0, file->size());
+        if (!data) {
+            throw std::exception(std::format("map file failed! {}", file->errorString().toStdString()).c_str());
+        }
+        d_->mapped_file = std::move(file);
+        d_->mapped_data = reinterpret_cast<const char*>(data);
+        loadBinaryData(d_->mapped_data, d_->mapped_file->size(), true);
+        return true;
+    } catch (const std::exception& excep) {
+        QMTL_LOG_ERROR("Failed to load mapped snapshot. Exception: {}", excep.what());
+        // 文件头无效时item还没有加载，只需关闭映射
+        d_->closeMapping();
+    }
+    return false;
+}
+
+bool QmTimelineItemModel::isItemMaterialized(QmItemID item_id) const
+{
+    return d_->items.contains(item_id);
+}
+
+QmTimelineItem* QmTimelineItemModel::materializeItem(QmItemID item_id) const
+{
+    auto lazy_it = d_->lazy_items.find(item_id);
+    if (lazy_it == d_->lazy_items.end()) {
+        return nullptr;
+    }
+    auto record = d_->lazyRecord(lazy_it->second);
+    QByteArrayView payload = d_->lazyPayload(record);
+    auto item = createRecordItem(record, payload);
+    if (!item) {
+        QMTL_LOG_ERROR("Failed to materialize item[{}].", item_id);
+        return nullptr;
+    }
+    d_->lazy_items.erase(lazy_it);
+    auto* item_ptr = item.get();
+    d_->items.insert(item_id, std::move(item));
+    d_->cachePayload(item_id, payload, record.flags);
+    return item_ptr;
+}
+
+void QmTimelineItemModel::materializeAll() const
+{
+    std::vector<QmItemID> item_ids;
+    item_ids.reserve(d_->lazy_items.size());
+    for (const auto& [item_id, _] : d_->lazy_items) {
+        item_ids.push_back(item_id);
+    }
+    for (auto item_id : item_ids) {
+        materializeItem(item_id);
+    }
+}
+
+std::unique_ptr<QmTimelineItem> QmTimelineItemModel::createRecordItem(const QmTimelineBinaryItemRecord& record, QByteArrayView payload) const
+{
+    // 此时item尚未登记，setStart等触发的属性通知会被忽略
+    auto item = QmTimelineItemFactory::instance().createItem(record.id, const_cast<QmTimelineItemModel*>(this));
+    if (!item) {
+        return nullptr;
+    }
+    item->setStart(record.start);
+    item->setDuration(record.duration);
+    item->setEnabled(record.flags & QmTimelineBinaryFormat::ItemEnabled);
+    if (!item->loadBinary(payload)) {
+        return nullptr;
+    }
+    item->resetDirty();
+    return item;
+}
+
+void QmTimelineItemModel::loadProperties(const nlohmann::json& j)
+{
+    d_->id_index = qMax(d_->id_index, j.at("id_index").get<QmItemID>());
+    j.at("hidden_rows").get_to(d_->hidden_rows);
+    j.at("locked_rows").get_to(d_->locked_rows);
+    if (j.contains("disabled_rows")) {
+        j["disabled_rows"].get_to(d_->disabled_rows);
+    }
+    j.at("frame_range").get_to(d_->frame_range);
+    j.at("view_frame_range").get_to(d_->view_frame_range);
+}
+
+QmItemID QmTimelineItemModel::appendLoadedItem(const nlohmann::json& item_j)
+{
+    // 只创建并追加到行索引末尾，调用者负责排序和通知
+    QmItemID item_id = item_j.at("id");
+    if (exists(item_id)) {
+        throw std::exception(std::format("duplicate item[{}]!", item_id).c_str());
+    }
+    auto item = QmTimelineItemFactory::instance().createItem(item_id, this);
+    if (!item) {
+        throw std::exception(std::format("create item[{}] failed!", item_id).c_str());
+    }
+    if (!item->load(item_j.at("data"))) {
+        throw std::exception(std::format("load item[{}] failed!", item_id).c_str());
+    }
+    int row_id = itemRowId(item_id);
+    d_->touchBatchRow(row_id);
+    d_->item_table[row_id].append(item_id, item->start(), item->end());
+    d_->items.insert(item_id, std::move(item));
+    d_->payload_misses.push_back(item_id);
+    return item_id;
+}
+
+void QmTimelineItemModel::notifyRangesChanged()
+{
+    // 通知Frame Range改变
+    emit frameMaximumChanged(d_->frame_range[1]);
+    emit frameMinimumChanged(d_->frame_range[0]);
+    emit viewFrameMaximumChanged(d_->view_frame_range[1]);
+    emit viewFrameMinimumChanged(d_->view_frame_range[0]);
+    emit fpsChanged(d_->fps);
+}
+
 QString QmTimelineItemModel::copyItem(QmItemID item_id) const
 {
     nlohmann::json j = saveItem(item_id);
@@ -949,50 +2190,23 @@ void QmTimelineItemModel::loadItem(const nlohmann::json& j, const std::optional<
         throw std::exception(std::format("frame range is occupied!").c_str());
     }
 
-    // 获取插入位置的item序号，同时修改插入位置之后的item序号
-    std::optional<int> number_opt;
-    if (d_->item_table.contains(row_id)) {
-        // 插入位置之后的item对应编号加一
-        for (auto it = d_->item_table[row_id].upper_bound(item->start()); it != d_->item_table[row_id].end(); ++it) {
-            if (!number_opt) {
-                auto item_number_opt = itemProperty(it->second, QmTimelineItem::NumberRole);
-                if (item_number_opt.has_value()) {
-                    number_opt = item_number_opt->value<int>();
-                }
-            }
-            requestItemOperate(it->second, QmTimelineItem::OperationRole::OpIncreaseNumberRole, 1);
-        }
-    }
-
-    QmItemID old_head = kInvalidItemID;
-    QmItemID old_tail = kInvalidItemID;
-    if (number_opt.has_value()) {
-        if (*number_opt == 1) {
-            old_head = headItem(row_id);
-        }
-    } else {
-        old_tail = tailItem(row_id);
+    // 插入位置即新item的序位，之后item的序号由行索引按需计算，无需逐个修改
+    qsizetype pos = 0;
+    if (const auto* index = d_->rowIndex(row_id); index) {
+        pos = index->upperBound(item->start());
     }
 
-    item->setNumber(number_opt.value_or(d_->item_table[row_id].size() + 1));
+    item->setNumber(static_cast<int>(pos + 1));
     emit itemAboutToBeCreated(item.get());
     // 登记item
-    d_->dirty = true;
-    d_->item_table[row_id][item->start()] = item_id;
-    d_->item_table_helper[row_id][item_id] = item->start();
-    d_->items[item_id] = std::move(item);
-    emit itemCreated(item_id);
-
-    if (headItem(row_id) == item_id) {
-        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsHead);
-    } else if (tailItem(row_id) == item_id) {
-        requestItemOperate(item_id, QmTimelineItem::OperationRole::OpUpdateAsTail);
-    }
-
-    if (old_head != kInvalidItemID) {
-        requestItemOperate(old_head, QmTimelineItem::OperationRole::OpUpdateAsHead);
-    } else if (old_tail != kInvalidItemID) {
-        requestItemOperate(old_tail, QmTimelineItem::OperationRole::OpUpdateAsTail);
+    d_->touchBatchRow(row_id);
+    d_->markDirty();
+    bool rows_moved = d_->indexItem(*item);
+    d_->items.insert(item_id, std::move(item));
+    d_->payload_misses.push_back(item_id);
+    notifyItemInserted(item_id);
+    if (rows_moved) {
+        emit rowsYChanged(row_id + 1);
     }
 
     if (j.contains("with_connection") && j["with_connection"].get<bool>()) {
@@ -1008,92 +2222,233 @@ void QmTimelineItemModel::loadItem(const nlohmann::json& j, const std::optional<
             createFrameConnection(item_id, next_item_id);
         }
     }
-    emit requestRebuildItemViewCache(item_id);
+    // 批量编辑中由场景在itemsBatchChanged时统一重建
+    if (d_->batch_depth == 0) {
+        emit requestRebuildItemViewCache(item_id);
+    }
+}
+
+QByteArray QmTimelineItemModel::saveItems(const std::vector<QmItemID>& item_ids) const
+{
+    // 布局: [item数][连接数][item记录表][连接记录表][payload数据区]，记录格式与二进制快照相同
+    std::vector<QmTimelineBinaryItemRecord> records;
+    records.reserve(item_ids.size());
+    // 每个item最多有一个后继连接，按起点去重
+    QmTimelineConnTable conns;
+    QByteArray payloads;
+    for (auto item_id : item_ids) {
+        QmTimelineBinaryItemRecord record;
+        if (auto* item = d_->items.find(item_id); item) {
+            const auto& cached = d_->ensurePayload(*item);
+            record.id = item_id;
+            record.start = item->start();
+            record.duration = item->duration();
+            record.flags = cached.flags;
+            record.payload_size = static_cast<quint32>(cached.payload.size());
+            record.payload_offset = static_cast<quint64>(payloads.size());
+            payloads.append(cached.payload);
+        } else if (auto lazy_it = d_->lazy_items.find(item_id); lazy_it != d_->lazy_items.end()) {
+            record = d_->lazyRecord(lazy_it->second);
+            QByteArrayView payload = d_->lazyPayload(record);
+            record.payload_offset = static_cast<quint64>(payloads.size());
+            payloads.append(payload);
+        } else {
+            continue;
+        }
+        records.push_back(record);
+        if (auto conn_id = previousConnection(item_id); conn_id.isValid()) {
+            conns[conn_id.from] = conn_id;
+        }
+        if (auto conn_id = nextConnection(item_id); conn_id.isValid()) {
+            conns[conn_id.from] = conn_id;
+        }
+    }
+
+    QByteArray data;
+    data.reserve(2 * sizeof(quint32) + records.size() * QmTimelineBinaryFormat::kItemRecordSize
+        + conns.size() * QmTimelineBinaryFormat::kConnRecordSize + payloads.size());
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << static_cast<quint32>(records.size()) << static_cast<quint32>(conns.size());
+    for (const auto& record : records) {
+        QmTimelineBinaryFormat::writeItemRecord(stream, record);
+    }
+    for (const auto& [_, conn_id] : conns) {
+        QmTimelineBinaryFormat::writeConnRecord(stream, conn_id);
+    }
+    stream.writeRawData(payloads.constData(), payloads.size());
+    return data;
+}
+
+bool QmTimelineItemModel::restoreItems(const QByteArray& data)
+{
+    const char* begin = data.constData();
+    qsizetype size = data.size();
+    if (size < static_cast<qsizetype>(2 * sizeof(quint32))) {
+        QMTL_LOG_ERROR("Failed to restore items. Invalid data.");
+        return false;
+    }
+    quint64 item_count = qFromLittleEndian<quint32>(begin);
+    quint64 conn_count = qFromLittleEndian<quint32>(begin + sizeof(quint32));
+    quint64 items_offset = 2 * sizeof(quint32);
+    quint64 conns_offset = items_offset + item_count * QmTimelineBinaryFormat::kItemRecordSize;
+    quint64 payload_offset = conns_offset + conn_count * QmTimelineBinaryFormat::kConnRecordSize;
+    if (payload_offset > static_cast<quint64>(size)) {
+        QMTL_LOG_ERROR("Failed to restore items. Invalid data.");
+        return false;
+    }
+    quint64 payload_size = static_cast<quint64>(size) - payload_offset;
+
+    std::vector<QmTimelineBinaryItemRecord> records;
+    records.reserve(item_count);
+    for (quint64 i = 0; i < item_count; ++i) {
+        auto record = QmTimelineBinaryFormat::readItemRecord(begin + items_offset + i * QmTimelineBinaryFormat::kItemRecordSize);
+        if (record.payload_offset > payload_size || record.payload_size > payload_size - record.payload_offset) {
+            QMTL_LOG_ERROR("Failed to restore items. Invalid payload of item[{}].", record.id);
+            return false;
+        }
+        if (exists(record.id)) {
+            continue;
+        }
+        // 全部item创建之后才插入索引，检查时索引仍是恢复之前的状态
+        if (const auto* index = d_->rowIndex(itemRowId(record.id)); index && index->isOccupied(record.start, record.start + record.duration)) {
+            emit errorOccurred(tr("Another frame already exists in the current location!"));
+            QMTL_LOG_ERROR("Failed to restore items. The time range of item[{}] is occupied.", record.id);
+            return false;
+        }
+        records.push_back(record);
+    }
+
+    QmTimelineBatchScope batch(this);
+    std::map<int, std::vector<QmTimelineRowRange::Entry>> row_entries;
+    std::set<int> new_rows;
+    for (const auto& record : records) {
+        QByteArrayView payload(begin + payload_offset + record.payload_offset, record.payload_size);
+        auto item = createRecordItem(record, payload);
+        if (!item) {
+            QMTL_LOG_ERROR("Failed to restore item[{}].", record.id);
+            continue;
+        }
+        int row_id = itemRowId(record.id);
+        emit itemAboutToBeCreated(item.get());
+        d_->touchBatchRow(row_id);
+        if (!d_->item_table.contains(row_id)) {
+            new_rows.insert(row_id);
+        }
+        row_entries[row_id].push_back({ record.id, record.start, record.start + record.duration });
+        d_->items.insert(record.id, std::move(item));
+        d_->cachePayload(record.id, payload, record.flags);
+        notifyItemInserted(record.id);
+    }
+    int first_moved_row = -1;
+    // 按行归并插入，不再对整行重新排序
+    for (auto& [row_id, entries] : row_entries) {
+        d_->item_table[row_id].insert(std::move(entries));
+        if (new_rows.contains(row_id) && d_->updateRowOffset(row_id) && first_moved_row < 0) {
+            first_moved_row = row_id;
+        }
+    }
+
+    // 恢复删除之前的连接，删除时在前后item之间建立的连接随之移除
+    for (quint64 i = 0; i < conn_count; ++i) {
+        auto conn_id = QmTimelineBinaryFormat::readConnRecord(begin + conns_offset + i * QmTimelineBinaryFormat::kConnRecordSize);
+        if (!exists(conn_id.from) || !exists(conn_id.to) || d_->isConnAlive(conn_id)) {
+            continue;
+        }
+        removeFrameNextConn(conn_id.from);
+        removeFramePrevConn(conn_id.to);
+        createFrameConnection(conn_id.from, conn_id.to);
+    }
+    d_->markDirty();
+    if (first_moved_row >= 0) {
+        emit rowsYChanged(first_moved_row + 1);
+    }
+    return true;
 }
 
 nlohmann::json QmTimelineItemModel::saveItem(QmItemID item_id) const
 {
     nlohmann::json item_j;
-    auto it = d_->items.find(item_id);
-    if (it == d_->items.end()) {
+    auto* item = d_->items.find(item_id);
+    if (!item) {
         return item_j;
     }
     item_j["id"] = item_id;
-    item_j["data"] = it->second->save();
+    item_j["data"] = item->save();
     item_j["with_connection"] = hasConnection(item_id);
     return item_j;
 }
 
 void from_json(const nlohmann::json& j, QmTimelineItemModel& model)
 {
-    j["id_index"].get_to(model.d_->id_index);
-    j["item_table"].get_to(model.d_->item_table);
-    j["item_table_helper"].get_to(model.d_->item_table_helper);
-    j["hidden_rows"].get_to(model.d_->hidden_rows);
-    j["locked_rows"].get_to(model.d_->locked_rows);
-    if (j.contains("disabled_rows")) {
-        j["disabled_rows"].get_to(model.d_->disabled_rows);
-    }
-    j["frame_range"].get_to(model.d_->frame_range);
-    j["view_frame_range"].get_to(model.d_->view_frame_range);
+    model.loadProperties(j);
 
-    nlohmann::json items_j = j["items"];
-    for (const auto& item_j : items_j) {
-        QmItemID item_id = item_j["id"];
-        auto item = QmTimelineItemFactory::instance().createItem(item_id, &model);
-        if (!item) {
-            throw std::exception(std::format("create item[{}] failed!", item_id).c_str());
-        }
-        if (!item->load(item_j["data"])) {
-            throw std::exception(std::format("load item[{}] failed!", item_id).c_str());
-        }
-        model.d_->items[item_id] = std::move(item);
-        emit model.itemCreated(item_id);
+    // 先登记所有item并整体排序建立行索引，再逐个通知，避免通知过程中看到不完整的索引
+    for (const auto& item_j : j["items"]) {
+        model.appendLoadedItem(item_j);
     }
+    for (auto& [_, index] : model.d_->item_table) {
+        index.sort();
+    }
+    model.d_->rebuildRowOffsets();
+    model.d_->items.forEach([&model](QmItemID item_id, QmTimelineItem*) { emit model.itemCreated(item_id); });
 
-    nlohmann::json prev_conns_j = j["prev_conns"];
-    for (const auto& conn_item_j : prev_conns_j) {
+    for (const auto& conn_item_j : j["prev_conns"]) {
         QmItemID item_id = conn_item_j["item_id"];
         QmItemConnID conn_id = conn_item_j["connection"];
         model.d_->prev_conns[item_id] = conn_id;
     }
 
-    nlohmann::json next_conns_j = j["next_conns"];
-    for (const auto& conn_item_j : next_conns_j) {
+    for (const auto& conn_item_j : j["next_conns"]) {
         QmItemID item_id = conn_item_j["item_id"];
         QmItemConnID conn_id = conn_item_j["connection"];
         model.d_->next_conns[item_id] = conn_id;
         emit model.itemConnCreated(conn_id);
     }
+    model.d_->resetConnsSnapshot();
 
     // 刷新每一行的头尾节点
-    for (const auto& [_, items] : model.d_->item_table) {
-        size_t item_size = items.size();
-        if (item_size == 0) {
+    for (const auto& [_, index] : model.d_->item_table) {
+        if (index.empty()) {
             continue;
         }
-        emit model.notifyItemOperateFinished(items.begin()->second, QmTimelineItem::OpUpdateAsHead);
-        if (auto tail_it = std::prev(items.end()); tail_it != items.begin()) {
-            emit model.notifyItemOperateFinished(tail_it->second, QmTimelineItem::OpUpdateAsTail);
+        emit model.notifyItemOperateFinished(index.idAt(0), QmTimelineItem::OpUpdateAsHead);
+        if (index.size() > 1) {
+            emit model.notifyItemOperateFinished(index.idAt(index.size() - 1), QmTimelineItem::OpUpdateAsTail);
         }
     }
 
-    // 通知Frame Range改变
-    emit model.frameMaximumChanged(model.d_->frame_range[1]);
-    emit model.frameMinimumChanged(model.d_->frame_range[0]);
-    emit model.viewFrameMaximumChanged(model.d_->view_frame_range[1]);
-    emit model.viewFrameMinimumChanged(model.d_->view_frame_range[0]);
-    emit model.fpsChanged(model.d_->fps);
+    model.notifyRangesChanged();
 
     // 所有数据加载完成之后重建cache
-    for (const auto& [id, _] : model.d_->items) {
-        emit model.requestRebuildItemViewCache(id);
+    model.d_->items.forEach([&model](QmItemID item_id, QmTimelineItem*) { emit model.requestRebuildItemViewCache(item_id); });
+}
+
+QmTimelineBatchScope::QmTimelineBatchScope(QmTimelineItemModel* model)
+    : model_(model)
+{
+    if (model_) {
+        model_->beginBatch();
+    }
+}
+
+QmTimelineBatchScope::~QmTimelineBatchScope() noexcept
+{
+    if (model_) {
+        model_->endBatch();
     }
 }
 
 void QmTimelineItemModel::notifyLanguageChanged()
 {
-    for (const auto& [item_id, item_ptr] : d_->items) {
+    // 信号处理中访问item可能创建尚未加载的item，先取出所有id再通知
+    std::vector<QmItemID> item_ids;
+    item_ids.reserve(d_->items.size() + d_->lazy_items.size());
+    d_->items.forEach([&item_ids](QmItemID item_id, QmTimelineItem*) { item_ids.push_back(item_id); });
+    for (const auto& [item_id, _] : d_->lazy_items) {
+        item_ids.push_back(item_id);
+    }
+    for (auto item_id : item_ids) {
         emit itemChanged(item_id, QmTimelineItem::ToolTipRole);
     }
 }
@@ -5,11 +5,21 @@
 #include "qmtimelinetype.h"
 #include <QObject>
 #include <QVariant>
+#include <span>
+
+class QIODevice;
+class QByteArrayView;
 
 namespace qmtl {
 
 class QmTimelineItem;
 class QmTimelineItemFactory;
+class QmTimelineRowIndex;
+class QmTimelineRowRange;
+class QmTimelineModelSnapshot;
+struct QmTimelineRowSlice;
+struct QmTimelineBinaryItemRecord;
+struct QmTimelineBinaryImage;
 struct QmTimelineItemModelPrivate;
 class QMTIMELINE_LIB_EXPORT QmTimelineItemModel : public QObject, public QmTimelineSerializable {
     Q_OBJECT
@@ -35,6 +45,8 @@ public:
     bool isFrameRangeOccupied(int row_id, qint64 start, qint64 duration, QmItemID except_item = kInvalidItemID) const;
 
     void removeItem(QmItemID item_id);
+    // 在一次批量编辑中删除多个item，每行的索引只修改一次，结果与逐个removeItem相同
+    void removeItems(const std::vector<QmItemID>& item_ids);
     QmItemID createItem(int item_type, int row_id, qint64 start, qint64 duration = 0, bool with_connection = false);
     QmItemConnID createFrameConnection(QmItemID from, QmItemID to);
     QmItemConnID previousConnection(QmItemID item_id) const;
@@ -83,22 +95,68 @@ public:
 
     void setFps(double fps);
     double fps() const;
+    // 帧率转换：按新旧帧率的比例缩放所有item的start、duration以及帧范围，setFps只修改帧率本身。
+    // 每行在线程池中独立计算，舍入后退化或重叠的区间在行内从左到右依次后推，结果与线程调度无关。
+    // 不调用item的setStart/setDuration，也不逐个发出itemChanged：已创建的item直接修改后调用QmTimelineItem::framesRescaled，
+    // 结束时只发出一次itemsRetimed
+    bool convertFps(double fps, QmFrameRounding rounding = QmFrameRounding::Nearest);
 
     virtual void clear();
     bool isDirty() const;
     void setDirty(bool dirty = true);
     void resetDirty();
+    // 只有revision之后没有新的修改时才清除，用于异步保存完成后只清除已经保存的修改
+    bool resetDirty(quint64 revision);
+    // 每次修改递增
+    quint64 revision() const;
 
     bool isFrameInRange(qint64 start, qint64 duration = 0) const;
     bool isItemInViewRange(QmItemID item_id) const;
 
     bool modifyItemStart(QmItemID item_id, qint64 start);
+    // 多个item整体平移delta帧，返回实际平移的帧数。
+    // 先遍历一次行索引求出整组不越过未选中的相邻item、不超出可视范围的最大平移量，再一次性应用，
+    // 组内item的相对位置不变，行索引中的顺序也不变。
+    // 与波纹编辑一样不调用setStart，全部平移完成后只发出一次itemsMoved
+    qint64 moveItems(std::span<const QmItemID> item_ids, qint64 delta);
+    // 波纹编辑：行中start >= from_frame的item整体平移delta帧(插入或删除一段时间)，返回实际平移的帧数。
+    // delta为负时不越过from_frame之前的item，且不超出可视范围。
+    // 不调用item的setStart，也不逐个发出itemChanged：已创建的item直接修改start并调用QmTimelineItem::framesShifted，
+    // 结束时只发出一次itemsRippled，场景只重新定位可视范围内的视图
+    qint64 rippleRow(int row_id, qint64 from_frame, qint64 delta);
+    // 所有行使用同一个平移量，取各行限制中最严格的
+    qint64 rippleAll(qint64 from_frame, qint64 delta);
+
+    // 批量编辑，可嵌套。期间item/连接的创建删除不再逐个通知，最外层endBatch时合并为一次itemsBatchChanged
+    void beginBatch();
+    void endBatch();
+    bool isInBatch() const;
 
     QmItemID headItem(int row_id) const;
     QmItemID tailItem(int row_id) const;
+    // item在所在行中的序号(从1开始)，item不存在时返回0
+    int itemNumber(QmItemID item_id) const;
     QmItemID previousItem(QmItemID item_id) const;
     QmItemID nextItem(QmItemID item_id) const;
+    // 复制整行，只需要读取一段时使用itemsInRange
     std::map<qint64, QmItemID> rowItems(int row_id) const;
+    // 行中与[from_frame, to_frame]有交集的item，直接引用行索引不复制，O(log n)
+    // 返回的视图在模型被修改之前有效
+    QmTimelineRowRange itemsInRange(int row_id, qint64 from_frame, qint64 to_frame) const;
+    // 所有行中与[from_frame, to_frame]有交集的item，按行号升序写入out(先清空)，跳过没有结果的行
+    // out可以在多次查询之间复用，容量足够时不分配内存
+    void itemsInRange(qint64 from_frame, qint64 to_frame, std::vector<QmTimelineRowSlice>& out) const;
+    // 所有行中在frame处活动(start <= frame <= end)的item，每行最多一个，按行号升序写入out(先清空)，返回数量
+    // 每行一次二分查找，O(rows·log n)；out容量足够时不分配内存
+    qsizetype itemsAt(qint64 frame, std::vector<QmItemID>& out) const;
+    // 所有行中与[from_frame, to_frame]有交集的item，按行号、start升序写入out(先清空)，返回数量
+    qsizetype itemsOverlapping(qint64 from_frame, qint64 to_frame, std::vector<QmItemID>& out) const;
+    // 行的区间索引，行中没有item时返回nullptr
+    const QmTimelineRowIndex* rowIndex(int row_id) const;
+    // 所有非空的行，升序
+    std::vector<int> rowIds() const;
+    // 只读快照，可以交给其他线程查询。行索引共享，连接表自上次快照以来没有变化时也共享
+    QmTimelineModelSnapshot snapshot() const;
 
     void notifyItemPropertyChanged(QmItemID item_id, int role, const QVariant& old_val = QVariant());
     void notifyItemOperateFinished(QmItemID item_id, int op_role, const QVariant& param = QVariant());
@@ -106,6 +164,28 @@ public:
     bool load(const nlohmann::json& j) override;
     nlohmann::json save() const override;
 
+    // 流式读取save()保存的JSON文档，不构建整个文档的DOM
+    bool loadStream(QIODevice& device);
+
+    // 二进制快照，与JSON格式保存的内容一致，可相互转换
+    bool loadBinary(QIODevice& device);
+    // device不能是loadMapped()打开的文件：截断该文件会使尚未创建的item的payload失效，这种情况返回false
+    bool saveBinary(QIODevice& device) const;
+    // 先写入临时文件再替换file_path。file_path是loadMapped()打开的文件时，先把映射的数据复制到内存并解除映射
+    bool saveBinary(const QString& file_path);
+    // 收集saveBinary()写出的全部数据。行索引和payload缓存都是写时复制的，这里只复制引用，
+    // 与item数量无关；item记录在writeImage中建立。
+    // 没有缓存的payload在这里同步编码(调用item的saveBinary)，需要避免时先用encodePayloads分批编码。
+    // 返回值不再引用model，可以交给其他线程写出
+    QmTimelineBinaryImage binaryImage() const;
+    // 编码最多max_items个没有缓存的payload，返回是否已经全部缓存。
+    // 从文件或撤销数据创建的item直接缓存读入的payload，只有新建、JSON加载和修改过的item需要编码
+    bool encodePayloads(qsizetype max_items);
+    // 以内存映射方式打开二进制快照，只建立行索引，item在item()第一次访问时才创建
+    // 映射在clear()或下一次加载之前保持打开
+    bool loadMapped(const QString& file_path);
+    bool isItemMaterialized(QmItemID item_id) const;
+
     qint64 frameToTime(qint64 frame_no) const;
 
     QString copyItem(QmItemID item_id) const;
@@ -120,14 +200,26 @@ signals:
     void itemRemoved(QmItemID item_id);
     void itemChanged(QmItemID item_id, int role, const QVariant& old_val = QVariant());
     void itemOperateFinished(QmItemID item_id, int op_role, const QVariant& param = QVariant());
+    // 行内序号不小于first_number的item序号发生了变化。
+    // 只对可视范围内的item发出itemChanged(NumberRole)，其余item的序号在number()时计算
+    void rowNumbersChanged(int row_id, int first_number);
 
     void itemConnCreated(const QmItemConnID& conn_id);
     void itemConnRemoved(const QmItemConnID& conn_id);
+    void itemsBatchChanged(const QmItemBatchChange& change);
 
     void requestRefreshItemViewCache(QmItemID item_id);
     void requestRebuildItemViewCache(QmItemID item_id);
 
     void requestUpdateItemY(QmItemID item_id);
+    // 行号不小于first_row的行纵向位置发生了变化
+    void rowsYChanged(int first_row);
+    // 波纹编辑平移了行中start >= from_frame的item(平移前的位置)，row_id为-1时表示所有行
+    void itemsRippled(int row_id, qint64 from_frame, qint64 delta);
+    // moveItems把item_ids整体平移了delta帧
+    void itemsMoved(const std::vector<QmItemID>& item_ids, qint64 delta);
+    // 帧率转换修改了所有item的位置，视图需要全部重新定位
+    void itemsRetimed(double fps);
 
     void frameMaximumChanged(qint64 maximum);
     void frameMinimumChanged(qint64 minimum);
@@ -142,17 +234,46 @@ protected:
 
 private:
     QmItemID nextItemID() const;
+    void notifyRowNumbersChanged(int row_id, qsizetype first_pos);
+    void notifyItemInserted(QmItemID item_id);
+    void notifyItemConnCreated(const QmItemConnID& conn_id);
+    void notifyItemConnRemoved(const QmItemConnID& conn_id);
+    void loadBinaryData(const char* data, qsizetype size, bool lazy);
+    QmTimelineItem* materializeItem(QmItemID item_id) const;
+    void materializeAll() const;
+    std::unique_ptr<QmTimelineItem> createRecordItem(const QmTimelineBinaryItemRecord& record, QByteArrayView payload) const;
+    void loadProperties(const nlohmann::json& j);
+    QmItemID appendLoadedItem(const nlohmann::json& item_j);
+    void notifyRangesChanged();
+    qint64 ripple(const std::vector<int>& row_ids, qint64 from_frame, qint64 delta);
 
     friend class QmTimelineItemCreateCommand;
     friend class QmTimelineItemDeleteCommand;
+    friend class QmTimelineItemsCreateCommand;
+    friend class QmTimelineItemsDeleteCommand;
     virtual void loadItem(
         const nlohmann::json& j, const std::optional<QmItemID>& item_id_opt = std::nullopt, const std::optional<qint64>& start = std::nullopt);
     virtual nlohmann::json saveItem(QmItemID item_id) const;
+    // 把多个item的定长记录、payload以及与它们相连的连接写入一块紧凑的缓冲区
+    QByteArray saveItems(const std::vector<QmItemID>& item_ids) const;
+    // 在一次批量编辑中恢复saveItems保存的item和连接，已存在的item跳过，任一item的位置被占用时不做修改
+    bool restoreItems(const QByteArray& data);
 
 private:
     QmTimelineItemModelPrivate* d_ { nullptr };
 };
 
+// 作用域内的批量编辑
+class QMTIMELINE_LIB_EXPORT QmTimelineBatchScope {
+public:
+    explicit QmTimelineBatchScope(QmTimelineItemModel* model);
+    ~QmTimelineBatchScope() noexcept;
+
+private:
+    Q_DISABLE_COPY_MOVE(QmTimelineBatchScope)
+    QmTimelineItemModel* model_ { nullptr };
+};
+
 inline constexpr int QmTimelineItemModel::itemRowId(QmItemID item_id)
 {
     return (item_id >> 48) & 0xFF;
@@ -0,0 +1,85 @@
+#include "qmtimelineitemslotmap.h"
+#include "qmtimelineitem.h"
+#include <algorithm>
+
+namespace qmtl {
+
+namespace {
+// 序号超出数组时，数组最多扩展到item数量的两倍加上这个余量
+constexpr QmItemID kSlotGrowthMargin = 4096;
+} // namespace
+
+QmTimelineItemSlotMap::QmTimelineItemSlotMap() = default;
+
+QmTimelineItemSlotMap::~QmTimelineItemSlotMap() noexcept = default;
+
+void QmTimelineItemSlotMap::insert(QmItemID item_id, std::unique_ptr<QmTimelineItem> item)
+{
+    if (!item) [[unlikely]] {
+        return;
+    }
+    erase(item_id);
+    QmItemID index = indexOf(item_id);
+    QmItemID limit = 2 * static_cast<QmItemID>(size_) + kSlotGrowthMargin;
+    if (slots_.empty()) {
+        base_ = index;
+    } else if (index < base_ && base_ - index < limit) {
+        growFront(base_ - index);
+    }
+    QmItemID pos = index - base_;
+    if (index >= base_ && pos >= slots_.size() && pos < limit) {
+        slots_.resize(pos + 1);
+    }
+    if (pos < slots_.size() && !slots_[pos].item) {
+        slots_[pos].id = item_id;
+        slots_[pos].item = std::move(item);
+    } else {
+        sparse_[item_id] = std::move(item);
+    }
+    ++size_;
+}
+
+bool QmTimelineItemSlotMap::erase(QmItemID item_id)
+{
+    QmItemID pos = indexOf(item_id) - base_;
+    if (pos < slots_.size() && slots_[pos].id == item_id && slots_[pos].item) {
+        slots_[pos].id = kInvalidItemID;
+        slots_[pos].item.reset();
+        --size_;
+        return true;
+    }
+    if (sparse_.erase(item_id) > 0) {
+        --size_;
+        return true;
+    }
+    return false;
+}
+
+void QmTimelineItemSlotMap::clear()
+{
+    slots_.clear();
+    sparse_.clear();
+    size_ = 0;
+    base_ = 0;
+}
+
+void QmTimelineItemSlotMap::growFront(QmItemID count)
+{
+    // 至少扩展一倍，按序号从大到小插入时均摊O(1)
+    count = std::min(std::max<QmItemID>(count, slots_.size()), base_);
+    std::vector<Slot> slots(slots_.size() + count);
+    std::move(slots_.begin(), slots_.end(), slots.begin() + count);
+    slots_ = std::move(slots);
+    base_ -= count;
+}
+
+QmTimelineItem* QmTimelineItemSlotMap::findSparse(QmItemID item_id) const
+{
+    auto it = sparse_.find(item_id);
+    if (it == sparse_.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+} // namespace qmtl
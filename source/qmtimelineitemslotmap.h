@@ -0,0 +1,119 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace qmtl {
+
+class QmTimelineItem;
+
+// 以item_id中的序号(id_index)为下标保存item，查找是O(1)的数组访问。
+// 槽中保存完整的item_id，类型、行不符或槽已清空的过期id查找结果为空。
+// 序号由模型递增分配，数组通常是稠密的；序号远大于item数量时(例如加载删除过大量item的文件)存入散列表，避免数组过度膨胀。
+// 模型清空后序号继续递增而不是从0开始，因此数组从清空后第一个插入的序号开始，向前插入时再扩展。
+class QMTIMELINE_LIB_EXPORT QmTimelineItemSlotMap {
+public:
+    QmTimelineItemSlotMap();
+    ~QmTimelineItemSlotMap() noexcept;
+    QmTimelineItemSlotMap(const QmTimelineItemSlotMap&) = delete;
+    QmTimelineItemSlotMap& operator=(const QmTimelineItemSlotMap&) = delete;
+
+    static constexpr QmItemID indexOf(QmItemID item_id);
+
+    inline QmTimelineItem* find(QmItemID item_id) const;
+    inline bool contains(QmItemID item_id) const;
+
+    // 已存在相同id的item时替换
+    void insert(QmItemID item_id, std::unique_ptr<QmTimelineItem> item);
+    bool erase(QmItemID item_id);
+    void clear();
+
+    inline qsizetype size() const;
+    inline bool empty() const;
+
+    // 按序号顺序遍历，fn(QmItemID, QmTimelineItem*)，遍历过程中不能修改容器
+    template <typename Fn>
+    void forEach(Fn&& fn) const;
+    template <typename Pred>
+    bool anyOf(Pred&& pred) const;
+
+private:
+    struct Slot {
+        QmItemID id { kInvalidItemID };
+        std::unique_ptr<QmTimelineItem> item;
+    };
+
+    QmTimelineItem* findSparse(QmItemID item_id) const;
+    void growFront(QmItemID count);
+
+private:
+    std::vector<Slot> slots_;
+    // slots_[0]对应的序号
+    QmItemID base_ { 0 };
+    std::unordered_map<QmItemID, std::unique_ptr<QmTimelineItem>> sparse_;
+    qsizetype size_ { 0 };
+};
+
+constexpr QmItemID QmTimelineItemSlotMap::indexOf(QmItemID item_id)
+{
+    return item_id & 0x0000FFFFFFFFFFFF;
+}
+
+inline QmTimelineItem* QmTimelineItemSlotMap::find(QmItemID item_id) const
+{
+    // 序号小于base_时无符号减法回绕，同样落在数组之外
+    QmItemID pos = indexOf(item_id) - base_;
+    if (pos < slots_.size() && slots_[pos].id == item_id) [[likely]] {
+        return slots_[pos].item.get();
+    }
+    return sparse_.empty() ? nullptr : findSparse(item_id);
+}
+
+inline bool QmTimelineItemSlotMap::contains(QmItemID item_id) const
+{
+    return find(item_id) != nullptr;
+}
+
+inline qsizetype QmTimelineItemSlotMap::size() const
+{
+    return size_;
+}
+
+inline bool QmTimelineItemSlotMap::empty() const
+{
+    return size_ == 0;
+}
+
+template <typename Fn>
+void QmTimelineItemSlotMap::forEach(Fn&& fn) const
+{
+    for (const auto& slot : slots_) {
+        if (slot.item) {
+            fn(slot.id, slot.item.get());
+        }
+    }
+    for (const auto& [item_id, item] : sparse_) {
+        fn(item_id, item.get());
+    }
+}
+
+template <typename Pred>
+bool QmTimelineItemSlotMap::anyOf(Pred&& pred) const
+{
+    for (const auto& slot : slots_) {
+        if (slot.item && pred(slot.id, slot.item.get())) {
+            return true;
+        }
+    }
+    for (const auto& [item_id, item] : sparse_) {
+        if (pred(item_id, item.get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace qmtl
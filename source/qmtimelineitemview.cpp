@@ -2,6 +2,7 @@
 #include "qmtimelineitem.h"
 #include "qmtimelineitemmodel.h"
 #include "qmtimelinescene.h"
+#include "qmtimelineshadow.h"
 #include <QGraphicsDropShadowEffect>
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
@@ -18,13 +19,24 @@ QmTimelineItemView::QmTimelineItemView(QmItemID item_id, QmTimelineScene* scene)
     updateX();
     updateY();
     setToolTip(model()->item(item_id)->toolTip());
-    {
-        QGraphicsDropShadowEffect* effect = new QGraphicsDropShadowEffect(this);
-        effect->setColor(Qt::black);
-        effect->setBlurRadius(20);
-        effect->setOffset(0);
-        setGraphicsEffect(effect);
+    setShadowMode(scene->shadowMode());
+}
+
+void QmTimelineItemView::bindItem(QmItemID item_id)
+{
+    item_id_ = item_id;
+    start_bak_ = -1;
+    prepareGeometryChange();
+    bounding_rect_ = calcBoundingRect();
+    updateShadowRect();
+    updateX();
+    updateY();
+    if (auto* item = model()->item(item_id_); item) {
+        setToolTip(item->toolTip());
+        setEnabled(item->isEnabled());
     }
+    rebuildCache();
+    update();
 }
 
 void QmTimelineItemView::fitInAxis()
@@ -37,13 +49,15 @@ void QmTimelineItemView::fitInAxis()
     if (!item) [[unlikely]] {
         return;
     }
-    bounding_rect_ = calcBoundingRect();
-    qreal x = scene->mapFrameToAxisX(item->start());
-
-    if (isInView()) {
+    // 缩放时宽度才会改变，平移时只需要更新x
+    QRectF bounding_rect = calcBoundingRect();
+    if (bounding_rect != bounding_rect_) {
         prepareGeometryChange();
+        bounding_rect_ = bounding_rect;
+        updateShadowRect();
     }
 
+    qreal x = scene->mapFrameToAxisX(item->start());
     if (!qFuzzyCompare(x, this->x())) {
         setX(x);
     }
@@ -130,6 +144,7 @@ bool QmTimelineItemView::onItemChanged(int role)
     if (role & QmTimelineItem::DurationRole) {
         bounding_rect_ = calcBoundingRect();
         prepareGeometryChange();
+        updateShadowRect();
         update();
         processed = true;
     }
@@ -187,6 +202,10 @@ void QmTimelineItemView::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
     if (start_bak_ == item->start()) {
         return;
     }
+    // 整体移动由场景统一通知
+    if (isInMultiSelection()) {
+        return;
+    }
     emit moveFinished(item_id_, start_bak_);
 }
 
@@ -203,12 +222,57 @@ void QmTimelineItemView::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
     if (new_start > model()->viewFrameMaximum() - item->duration()) {
         new_start = model()->viewFrameMaximum() - item->duration();
     }
+    new_start = sceneRef().snapItemStart(item_id_, new_start).start;
     if (new_start == item->start()) {
         return;
     }
+    if (isInMultiSelection()) {
+        emit requestMoveSelection(item_id_, new_start);
+        return;
+    }
     emit requestMove(item_id_, new_start);
 }
 
+bool QmTimelineItemView::isInMultiSelection() const
+{
+    return isSelected() && scene()->selectedItems().size() > 1;
+}
+
+void QmTimelineItemView::setShadowMode(QmShadowMode mode)
+{
+    if (mode == shadow_mode_) {
+        return;
+    }
+    shadow_mode_ = mode;
+    // setGraphicsEffect会删除之前的效果
+    setGraphicsEffect(nullptr);
+    delete shadow_item_;
+    shadow_item_ = nullptr;
+
+    if (mode == QmShadowMode::Effect) {
+        QGraphicsDropShadowEffect* effect = new QGraphicsDropShadowEffect(this);
+        effect->setColor(Qt::black);
+        effect->setBlurRadius(QmTimelineShadowItem::kBlurRadius);
+        effect->setOffset(0);
+        setGraphicsEffect(effect);
+    } else if (mode == QmShadowMode::Cached) {
+        shadow_item_ = new QmTimelineShadowItem(this);
+        updateShadowRect();
+    }
+}
+
+QmShadowMode QmTimelineItemView::shadowMode() const
+{
+    return shadow_mode_;
+}
+
+void QmTimelineItemView::updateShadowRect()
+{
+    if (shadow_item_) {
+        shadow_item_->setRect(bounding_rect_);
+    }
+}
+
 void QmTimelineItemView::refreshCache()
 {
 }
@@ -8,6 +8,7 @@ namespace qmtl {
 
 class QmTimelineScene;
 class QmTimelineItemModel;
+class QmTimelineShadowItem;
 class QMTIMELINE_LIB_EXPORT QmTimelineItemView : public QGraphicsObject {
     Q_OBJECT
 public:
@@ -22,6 +23,8 @@ public:
     qreal itemMargin() const;
 
     inline QmItemID itemId() const;
+    // 重新绑定到另一个item，视图对象从场景的对象池中复用时调用
+    virtual void bindItem(QmItemID item_id);
 
     QmTimelineItemModel* model() const;
     QmTimelineScene& sceneRef();
@@ -31,6 +34,9 @@ public:
     virtual void updateY();
     virtual bool isInView() const;
 
+    void setShadowMode(QmShadowMode mode);
+    QmShadowMode shadowMode() const;
+
     virtual void fitInAxis();
     virtual void refreshCache();
     virtual void rebuildCache();
@@ -41,6 +47,8 @@ public:
 signals:
     void requestMove(QmItemID item_id, qint64 new_start);
     void moveFinished(QmItemID item_id, qint64 old_start);
+    // 拖动多选中的一个item时发出，由场景移动整个选择
+    void requestMoveSelection(QmItemID item_id, qint64 new_start);
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
@@ -49,11 +57,17 @@ protected:
 
 protected:
     virtual QRectF calcBoundingRect() const;
+    void updateShadowRect();
+    bool isInMultiSelection() const;
 
 protected:
     qint64 start_bak_ { -1 };
     QmItemID item_id_ { kInvalidItemID };
     mutable QRectF bounding_rect_;
+
+private:
+    QmShadowMode shadow_mode_ { QmShadowMode::None };
+    QmTimelineShadowItem* shadow_item_ { nullptr };
 };
 
 inline QmItemID QmTimelineItemView::itemId() const
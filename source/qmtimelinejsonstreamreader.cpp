@@ -0,0 +1,280 @@
+#include "qmtimelinejsonstreamreader.h"
+#include <QIODevice>
+#include <array>
+#include <istream>
+#include <streambuf>
+
+namespace qmtl {
+
+namespace {
+// 按块从QIODevice读取数据，供nlohmann::json的istream输入使用
+class IODeviceStreamBuf : public std::streambuf {
+public:
+    explicit IODeviceStreamBuf(QIODevice& device)
+        : device_(device)
+    {
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        qint64 count = device_.read(buffer_.data(), static_cast<qint64>(buffer_.size()));
+        if (count <= 0) {
+            return traits_type::eof();
+        }
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    QIODevice& device_;
+    std::array<char, 64 * 1024> buffer_ {};
+};
+} // namespace
+
+void QmTimelineJsonStreamReader::setArrayHandler(const std::string& key, const ElementHandler& handler)
+{
+    array_handlers_[key] = handler;
+}
+
+void QmTimelineJsonStreamReader::setSkippedKeys(const std::set<std::string>& keys)
+{
+    skipped_keys_ = keys;
+}
+
+bool QmTimelineJsonStreamReader::read(QIODevice& device)
+{
+    section_ = Section::Document;
+    current_key_.clear();
+    skip_depth_ = 0;
+    properties_ = nlohmann::json::object();
+    value_ = nullptr;
+    value_stack_.clear();
+    object_element_ = nullptr;
+    error_string_.clear();
+
+    if (!device.isReadable()) {
+        error_string_ = QStringLiteral("The device is not readable.");
+        return false;
+    }
+
+    IODeviceStreamBuf buffer(device);
+    std::istream stream(&buffer);
+    if (!nlohmann::json::sax_parse(stream, this)) {
+        return false;
+    }
+    if (section_ != Section::Finished) {
+        error_string_ = QStringLiteral("Unexpected end of document.");
+        return false;
+    }
+    return true;
+}
+
+const nlohmann::json& QmTimelineJsonStreamReader::properties() const
+{
+    return properties_;
+}
+
+QString QmTimelineJsonStreamReader::errorString() const
+{
+    return error_string_;
+}
+
+bool QmTimelineJsonStreamReader::null()
+{
+    return value(nullptr);
+}
+
+bool QmTimelineJsonStreamReader::boolean(bool val)
+{
+    return value(val);
+}
+
+bool QmTimelineJsonStreamReader::number_integer(number_integer_t val)
+{
+    return value(val);
+}
+
+bool QmTimelineJsonStreamReader::number_unsigned(number_unsigned_t val)
+{
+    return value(val);
+}
+
+bool QmTimelineJsonStreamReader::number_float(number_float_t val, const string_t&)
+{
+    return value(val);
+}
+
+bool QmTimelineJsonStreamReader::string(string_t& val)
+{
+    return value(val);
+}
+
+bool QmTimelineJsonStreamReader::binary(binary_t& val)
+{
+    return value(nlohmann::json::binary(val));
+}
+
+bool QmTimelineJsonStreamReader::start_object(std::size_t)
+{
+    return startContainer(nlohmann::json::object());
+}
+
+bool QmTimelineJsonStreamReader::key(string_t& val)
+{
+    switch (section_) {
+    case Section::Root:
+        current_key_ = val;
+        return true;
+    case Section::Property:
+    case Section::Array:
+        object_element_ = &(*value_stack_.back())[val];
+        return true;
+    case Section::Skip:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool QmTimelineJsonStreamReader::end_object()
+{
+    return endContainer();
+}
+
+bool QmTimelineJsonStreamReader::start_array(std::size_t)
+{
+    return startContainer(nlohmann::json::array());
+}
+
+bool QmTimelineJsonStreamReader::end_array()
+{
+    return endContainer();
+}
+
+bool QmTimelineJsonStreamReader::parse_error(std::size_t position, const std::string&, const nlohmann::json::exception& ex)
+{
+    error_string_ = QStringLiteral("Parse error at %1: %2").arg(position).arg(QString::fromStdString(ex.what()));
+    return false;
+}
+
+bool QmTimelineJsonStreamReader::value(nlohmann::json&& val)
+{
+    switch (section_) {
+    case Section::Root:
+        if (!skipped_keys_.contains(current_key_)) {
+            properties_[current_key_] = std::move(val);
+        }
+        return true;
+    case Section::Property:
+    case Section::Array:
+        appendValue(std::move(val));
+        finishValue();
+        return true;
+    case Section::Skip:
+        return true;
+    default:
+        break;
+    }
+    error_string_ = QStringLiteral("The document root must be an object.");
+    return false;
+}
+
+bool QmTimelineJsonStreamReader::startContainer(nlohmann::json&& container)
+{
+    switch (section_) {
+    case Section::Document:
+        if (!container.is_object()) {
+            error_string_ = QStringLiteral("The document root must be an object.");
+            return false;
+        }
+        section_ = Section::Root;
+        return true;
+    case Section::Root:
+        if (skipped_keys_.contains(current_key_)) {
+            section_ = Section::Skip;
+            skip_depth_ = 1;
+            return true;
+        }
+        if (container.is_array() && array_handlers_.contains(current_key_)) {
+            // 数组本身不保存，只逐个构建元素
+            section_ = Section::Array;
+            return true;
+        }
+        section_ = Section::Property;
+        [[fallthrough]];
+    case Section::Property:
+    case Section::Array:
+        value_stack_.push_back(appendValue(std::move(container)));
+        return true;
+    case Section::Skip:
+        ++skip_depth_;
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool QmTimelineJsonStreamReader::endContainer()
+{
+    switch (section_) {
+    case Section::Root:
+        section_ = Section::Finished;
+        return true;
+    case Section::Skip:
+        if (--skip_depth_ == 0) {
+            section_ = Section::Root;
+        }
+        return true;
+    case Section::Array:
+        if (value_stack_.empty()) {
+            section_ = Section::Root;
+            return true;
+        }
+        [[fallthrough]];
+    case Section::Property:
+        value_stack_.pop_back();
+        finishValue();
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+nlohmann::json* QmTimelineJsonStreamReader::appendValue(nlohmann::json&& val)
+{
+    if (value_stack_.empty()) {
+        value_ = std::move(val);
+        return &value_;
+    }
+    // 父容器中正在构建的总是最后一个元素，之前保存的指针不会因为插入而失效
+    auto* parent = value_stack_.back();
+    if (parent->is_array()) {
+        parent->push_back(std::move(val));
+        return &parent->back();
+    }
+    *object_element_ = std::move(val);
+    return object_element_;
+}
+
+void QmTimelineJsonStreamReader::finishValue()
+{
+    if (!value_stack_.empty()) {
+        return;
+    }
+    if (section_ == Section::Property) {
+        properties_[current_key_] = std::move(value_);
+        section_ = Section::Root;
+    } else if (section_ == Section::Array) {
+        array_handlers_[current_key_](std::move(value_));
+    }
+    value_ = nullptr;
+}
+
+} // namespace qmtl
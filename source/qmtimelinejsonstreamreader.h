@@ -0,0 +1,76 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "nlohmann/json.hpp"
+#include <QString>
+#include <functional>
+#include <set>
+
+class QIODevice;
+
+namespace qmtl {
+
+// 以SAX方式读取顶层为对象的JSON文档，不构建整个文档的DOM。
+// 登记了处理函数的顶层数组逐个元素构建并回调，元素处理完即释放；
+// 登记为跳过的顶层字段只做语法检查；其余顶层字段保存在properties()中。
+class QMTIMELINE_LIB_EXPORT QmTimelineJsonStreamReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    using ElementHandler = std::function<void(nlohmann::json&& element)>;
+
+    void setArrayHandler(const std::string& key, const ElementHandler& handler);
+    void setSkippedKeys(const std::set<std::string>& keys);
+
+    // 处理函数抛出的异常会直接传递给调用者
+    bool read(QIODevice& device);
+
+    const nlohmann::json& properties() const;
+    QString errorString() const;
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::json::exception& ex) override;
+
+private:
+    enum class Section {
+        Document,
+        Root,
+        Property,
+        Array,
+        Skip,
+        Finished,
+    };
+
+    bool value(nlohmann::json&& val);
+    bool startContainer(nlohmann::json&& container);
+    bool endContainer();
+    nlohmann::json* appendValue(nlohmann::json&& val);
+    void finishValue();
+
+private:
+    std::map<std::string, ElementHandler> array_handlers_;
+    std::set<std::string> skipped_keys_;
+
+    Section section_ { Section::Document };
+    std::string current_key_;
+    int skip_depth_ { 0 };
+    nlohmann::json properties_ = nlohmann::json::object();
+
+    // 正在构建的值(一个顶层字段或者数组中的一个元素)
+    nlohmann::json value_;
+    std::vector<nlohmann::json*> value_stack_;
+    nlohmann::json* object_element_ { nullptr };
+
+    QString error_string_;
+};
+
+} // namespace qmtl
@@ -0,0 +1,168 @@
+#include "qmtimelinemodelsnapshot.h"
+
+namespace qmtl {
+
+namespace {
+const QmTimelineModelSnapshotData& emptySnapshotData()
+{
+    static const QmTimelineModelSnapshotData data;
+    return data;
+}
+
+QmItemConnID findConnection(const std::shared_ptr<const QmTimelineConnTable>& conns, QmItemID item_id)
+{
+    if (!conns) {
+        return {};
+    }
+    auto it = conns->find(item_id);
+    if (it == conns->end()) {
+        return {};
+    }
+    return it->second;
+}
+} // namespace
+
+QmTimelineModelSnapshot::QmTimelineModelSnapshot() = default;
+
+QmTimelineModelSnapshot::QmTimelineModelSnapshot(std::shared_ptr<const QmTimelineModelSnapshotData> data)
+    : d_(std::move(data))
+{
+}
+
+bool QmTimelineModelSnapshot::isNull() const
+{
+    return !d_;
+}
+
+qsizetype QmTimelineModelSnapshot::itemCount() const
+{
+    return d_ ? d_->item_count : 0;
+}
+
+std::vector<int> QmTimelineModelSnapshot::rowIds() const
+{
+    std::vector<int> row_ids;
+    if (!d_) {
+        return row_ids;
+    }
+    row_ids.reserve(d_->rows.size());
+    for (const auto& [row_id, _] : d_->rows) {
+        row_ids.push_back(row_id);
+    }
+    return row_ids;
+}
+
+const QmTimelineRowIndex* QmTimelineModelSnapshot::rowIndex(int row_id) const
+{
+    if (!d_) {
+        return nullptr;
+    }
+    auto it = d_->rows.find(row_id);
+    if (it == d_->rows.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+QmTimelineRowRange QmTimelineModelSnapshot::itemsInRange(int row_id, qint64 from_frame, qint64 to_frame) const
+{
+    const auto* index = rowIndex(row_id);
+    if (!index) {
+        return {};
+    }
+    return index->overlapping(from_frame, to_frame);
+}
+
+void QmTimelineModelSnapshot::itemsInRange(qint64 from_frame, qint64 to_frame, std::vector<QmTimelineRowSlice>& out) const
+{
+    out.clear();
+    if (!d_) {
+        return;
+    }
+    for (const auto& [row_id, index] : d_->rows) {
+        auto range = index.overlapping(from_frame, to_frame);
+        if (!range.empty()) {
+            out.push_back({ row_id, range });
+        }
+    }
+}
+
+qsizetype QmTimelineModelSnapshot::itemsAt(qint64 frame, std::vector<QmItemID>& out) const
+{
+    out.clear();
+    if (!d_) {
+        return 0;
+    }
+    for (const auto& [_, index] : d_->rows) {
+        qsizetype pos = index.stab(frame);
+        if (pos != QmTimelineRowIndex::npos) {
+            out.push_back(index.idAt(pos));
+        }
+    }
+    return static_cast<qsizetype>(out.size());
+}
+
+qsizetype QmTimelineModelSnapshot::itemsOverlapping(qint64 from_frame, qint64 to_frame, std::vector<QmItemID>& out) const
+{
+    out.clear();
+    if (!d_) {
+        return 0;
+    }
+    for (const auto& [_, index] : d_->rows) {
+        auto ids = index.overlapping(from_frame, to_frame).ids();
+        out.insert(out.end(), ids.begin(), ids.end());
+    }
+    return static_cast<qsizetype>(out.size());
+}
+
+QmItemConnID QmTimelineModelSnapshot::previousConnection(QmItemID item_id) const
+{
+    return d_ ? findConnection(d_->prev_conns, item_id) : QmItemConnID {};
+}
+
+QmItemConnID QmTimelineModelSnapshot::nextConnection(QmItemID item_id) const
+{
+    return d_ ? findConnection(d_->next_conns, item_id) : QmItemConnID {};
+}
+
+bool QmTimelineModelSnapshot::isRowHidden(int row_id) const
+{
+    return d_ && d_->hidden_rows.contains(row_id);
+}
+
+bool QmTimelineModelSnapshot::isRowLocked(int row_id) const
+{
+    return d_ && d_->locked_rows.contains(row_id);
+}
+
+bool QmTimelineModelSnapshot::isRowDisabled(int row_id) const
+{
+    return d_ && d_->disabled_rows.contains(row_id);
+}
+
+qint64 QmTimelineModelSnapshot::frameMinimum() const
+{
+    return (d_ ? *d_ : emptySnapshotData()).frame_range[0];
+}
+
+qint64 QmTimelineModelSnapshot::frameMaximum() const
+{
+    return (d_ ? *d_ : emptySnapshotData()).frame_range[1];
+}
+
+qint64 QmTimelineModelSnapshot::viewFrameMinimum() const
+{
+    return (d_ ? *d_ : emptySnapshotData()).view_frame_range[0];
+}
+
+qint64 QmTimelineModelSnapshot::viewFrameMaximum() const
+{
+    return (d_ ? *d_ : emptySnapshotData()).view_frame_range[1];
+}
+
+double QmTimelineModelSnapshot::fps() const
+{
+    return (d_ ? *d_ : emptySnapshotData()).fps;
+}
+
+} // namespace qmtl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinerowindex.h"
+#include "qmtimelinetype.h"
+#include <array>
+#include <map>
+#include <memory>
+#include <set>
+
+namespace qmtl {
+
+struct QmTimelineModelSnapshotData {
+    // 行索引是隐式共享的，复制只增加引用计数
+    std::map<int, QmTimelineRowIndex> rows;
+    std::set<int> hidden_rows;
+    std::set<int> locked_rows;
+    std::set<int> disabled_rows;
+    // 连接表在两次快照之间没有变化时由多个快照共用
+    std::shared_ptr<const QmTimelineConnTable> next_conns;
+    std::shared_ptr<const QmTimelineConnTable> prev_conns;
+    std::array<qint64, 2> frame_range { 0, 1 };
+    std::array<qint64, 2> view_frame_range { 0, 1 };
+    double fps { 24.0 };
+    qsizetype item_count { 0 };
+};
+
+// 模型在某一时刻的只读快照，由QmTimelineItemModel::snapshot()在GUI线程创建。
+// 快照与模型共享未修改的数据，模型之后的修改不会影响快照，任何线程都可以不加锁地查询和复制快照。
+// 快照只包含item的区间和连接，item对象本身(属性、payload)仍然只能在GUI线程访问。
+class QMTIMELINE_LIB_EXPORT QmTimelineModelSnapshot {
+public:
+    QmTimelineModelSnapshot();
+    explicit QmTimelineModelSnapshot(std::shared_ptr<const QmTimelineModelSnapshotData> data);
+
+    bool isNull() const;
+
+    qsizetype itemCount() const;
+    std::vector<int> rowIds() const;
+    const QmTimelineRowIndex* rowIndex(int row_id) const;
+
+    // 与QmTimelineItemModel中的同名查询相同
+    QmTimelineRowRange itemsInRange(int row_id, qint64 from_frame, qint64 to_frame) const;
+    void itemsInRange(qint64 from_frame, qint64 to_frame, std::vector<QmTimelineRowSlice>& out) const;
+    qsizetype itemsAt(qint64 frame, std::vector<QmItemID>& out) const;
+    qsizetype itemsOverlapping(qint64 from_frame, qint64 to_frame, std::vector<QmItemID>& out) const;
+
+    QmItemConnID previousConnection(QmItemID item_id) const;
+    QmItemConnID nextConnection(QmItemID item_id) const;
+
+    bool isRowHidden(int row_id) const;
+    bool isRowLocked(int row_id) const;
+    bool isRowDisabled(int row_id) const;
+
+    qint64 frameMinimum() const;
+    qint64 frameMaximum() const;
+    qint64 viewFrameMinimum() const;
+    qint64 viewFrameMaximum() const;
+    double fps() const;
+
+private:
+    std::shared_ptr<const QmTimelineModelSnapshotData> d_;
+};
+
+} // namespace qmtl
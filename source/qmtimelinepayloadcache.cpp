@@ -0,0 +1,59 @@
+#include "qmtimelinepayloadcache.h"
+#include "qmtimelineitemslotmap.h"
+
+namespace qmtl {
+
+std::size_t QmTimelinePayloadCache::bucketOf(QmItemID item_id)
+{
+    // 序号由模型递增分配，低位分布均匀
+    return static_cast<std::size_t>(QmTimelineItemSlotMap::indexOf(item_id) % kBucketCount);
+}
+
+QmTimelinePayloadCache::Bucket& QmTimelinePayloadCache::mutableBucket(std::size_t bucket)
+{
+    auto& ptr = buckets_[bucket];
+    if (!ptr) {
+        ptr = std::make_shared<Bucket>();
+    } else if (ptr.use_count() > 1) {
+        // 其他线程只会释放副本，不会增加引用，计数过时只会多复制一次
+        ptr = std::make_shared<Bucket>(*ptr);
+    }
+    return *ptr;
+}
+
+const QmTimelinePayloadCache::Entry* QmTimelinePayloadCache::find(QmItemID item_id) const
+{
+    const auto& bucket = buckets_[bucketOf(item_id)];
+    if (!bucket) {
+        return nullptr;
+    }
+    auto it = bucket->find(item_id);
+    return it != bucket->end() ? &it->second : nullptr;
+}
+
+bool QmTimelinePayloadCache::contains(QmItemID item_id) const
+{
+    return find(item_id) != nullptr;
+}
+
+void QmTimelinePayloadCache::insert(QmItemID item_id, Entry entry)
+{
+    mutableBucket(bucketOf(item_id)).insert_or_assign(item_id, std::move(entry));
+}
+
+bool QmTimelinePayloadCache::erase(QmItemID item_id)
+{
+    std::size_t bucket = bucketOf(item_id);
+    if (!buckets_[bucket] || !buckets_[bucket]->contains(item_id)) {
+        return false;
+    }
+    return mutableBucket(bucket).erase(item_id) > 0;
+}
+
+void QmTimelinePayloadCache::clear()
+{
+    // 副本继续持有原来的桶
+    buckets_ = {};
+}
+
+} // namespace qmtl
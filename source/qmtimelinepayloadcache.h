@@ -0,0 +1,43 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <QByteArray>
+#include <array>
+#include <memory>
+#include <unordered_map>
+
+namespace qmtl {
+
+// 已创建item的payload(saveBinary()的结果)缓存。
+// 按id中的序号分桶，每个桶写时复制：复制缓存只复制各桶的指针，O(kBucketCount)，
+// 之后GUI线程修改某个仍被副本引用的桶时才复制该桶。副本可以交给其他线程只读访问。
+class QMTIMELINE_LIB_EXPORT QmTimelinePayloadCache {
+public:
+    static constexpr std::size_t kBucketCount = 256;
+
+    struct Entry {
+        QByteArray payload;
+        // QmTimelineBinaryFormat::ItemFlag
+        quint32 flags { 0 };
+    };
+
+    const Entry* find(QmItemID item_id) const;
+    bool contains(QmItemID item_id) const;
+    // 已存在时替换
+    void insert(QmItemID item_id, Entry entry);
+    bool erase(QmItemID item_id);
+    void clear();
+
+private:
+    using Bucket = std::unordered_map<QmItemID, Entry>;
+
+    static std::size_t bucketOf(QmItemID item_id);
+    // 桶被副本共享时先复制
+    Bucket& mutableBucket(std::size_t bucket);
+
+private:
+    std::array<std::shared_ptr<Bucket>, kBucketCount> buckets_;
+};
+
+} // namespace qmtl
@@ -0,0 +1,230 @@
+#include "qmtimelineplaybackclock.h"
+#include "qmtimelineitemmodel.h"
+#include "qmtimelineplaybackcursor.h"
+#include "qmtimelineview.h"
+#include <QGuiApplication>
+#include <QPointer>
+#include <QScreen>
+#include <QTimer>
+#include <QtMath>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace qmtl {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// 提前这么久从等待中醒来，剩余时间自旋，避免系统定时器精度带来的迟到
+constexpr auto kSpinMargin = std::chrono::microseconds(1500);
+// 最新帧槽位为空时的值
+constexpr qint64 kNoTick = std::numeric_limits<qint64>::min();
+constexpr qreal kDefaultRefreshRate = 60.0;
+} // namespace
+
+struct QmTimelinePlaybackClockPrivate {
+    QmTimelineItemModel* model { nullptr };
+    QPointer<QmTimelineView> view;
+    QPointer<QmTimelinePlaybackCursor> cursor;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> running { false };
+    // 时钟线程写入的最新帧，GUI线程取走后置为kNoTick。
+    // 新帧覆盖未取走的旧帧，结束帧总是最后写入，不会丢失
+    std::atomic<qint64> latest_frame { kNoTick };
+
+    QTimer refresh_timer;
+    qint64 frame { 0 };
+    qint64 end_frame { 0 };
+
+    // 以下统计只由时钟线程写入
+    std::atomic<quint64> tick_count { 0 };
+    std::atomic<quint64> skipped_frames { 0 };
+    std::atomic<quint64> dropped_ticks { 0 };
+    std::atomic<qint64> last_lateness_ns { 0 };
+    std::atomic<qint64> max_lateness_ns { 0 };
+    std::atomic<qint64> total_lateness_ns { 0 };
+};
+
+QmTimelinePlaybackClock::QmTimelinePlaybackClock(QmTimelineItemModel* model, QObject* parent)
+    : QObject(parent)
+    , d_(new QmTimelinePlaybackClockPrivate)
+{
+    d_->model = model;
+    d_->refresh_timer.setTimerType(Qt::PreciseTimer);
+    connect(&d_->refresh_timer, &QTimer::timeout, this, &QmTimelinePlaybackClock::drainTicks);
+    connect(model, &QmTimelineItemModel::fpsChanged, this, &QmTimelinePlaybackClock::onFpsChanged);
+}
+
+QmTimelinePlaybackClock::~QmTimelinePlaybackClock() noexcept
+{
+    stop();
+    delete d_;
+}
+
+void QmTimelinePlaybackClock::setView(QmTimelineView* view)
+{
+    d_->view = view;
+}
+
+void QmTimelinePlaybackClock::setCursor(QmTimelinePlaybackCursor* cursor)
+{
+    d_->cursor = cursor;
+}
+
+void QmTimelinePlaybackClock::start(qint64 frame)
+{
+    stop();
+    double fps = d_->model->fps();
+    if (fps <= 0) {
+        return;
+    }
+    d_->frame = frame;
+    d_->end_frame = d_->model->frameMaximum();
+    if (d_->cursor && d_->cursor->frame() != frame) {
+        d_->cursor->seek(frame);
+    }
+    if (d_->view) {
+        d_->view->movePlayhead(frame);
+    }
+    emit frameChanged(frame);
+    if (frame >= d_->end_frame) {
+        emit finished();
+        return;
+    }
+
+    // 每次屏幕刷新最多更新一次界面
+    auto* screen = QGuiApplication::primaryScreen();
+    qreal refresh_rate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : kDefaultRefreshRate;
+    d_->refresh_timer.start(qMax(1, qFloor(1000.0 / refresh_rate)));
+
+    d_->running = true;
+    d_->thread = std::thread([this, frame, fps] { run(frame, fps); });
+}
+
+void QmTimelinePlaybackClock::stop()
+{
+    {
+        std::lock_guard lock(d_->mutex);
+        d_->running = false;
+    }
+    d_->wake.notify_all();
+    if (d_->thread.joinable()) {
+        d_->thread.join();
+    }
+    d_->refresh_timer.stop();
+    d_->latest_frame.store(kNoTick, std::memory_order_relaxed);
+}
+
+bool QmTimelinePlaybackClock::isRunning() const
+{
+    return d_->refresh_timer.isActive();
+}
+
+qint64 QmTimelinePlaybackClock::frame() const
+{
+    return d_->frame;
+}
+
+QmTimelinePlaybackStatistics QmTimelinePlaybackClock::statistics() const
+{
+    QmTimelinePlaybackStatistics result;
+    result.ticks = d_->tick_count.load();
+    result.skipped_frames = d_->skipped_frames.load();
+    result.dropped_ticks = d_->dropped_ticks.load();
+    result.last_lateness_ns = d_->last_lateness_ns.load();
+    result.max_lateness_ns = d_->max_lateness_ns.load();
+    if (result.ticks > 0) {
+        result.mean_lateness_ns = static_cast<double>(d_->total_lateness_ns.load()) / static_cast<double>(result.ticks);
+    }
+    return result;
+}
+
+void QmTimelinePlaybackClock::resetStatistics()
+{
+    d_->tick_count = 0;
+    d_->skipped_frames = 0;
+    d_->dropped_ticks = 0;
+    d_->last_lateness_ns = 0;
+    d_->max_lateness_ns = 0;
+    d_->total_lateness_ns = 0;
+}
+
+void QmTimelinePlaybackClock::run(qint64 start_frame, double fps)
+{
+    // 运行在时钟线程，除等待用的锁外只访问原子变量；帧号写入latest_frame，由GUI线程取走最新的一帧
+    const auto origin = Clock::now();
+    const qint64 end_frame = d_->end_frame;
+    qint64 elapsed_frames = 0;
+    while (true) {
+        qint64 next = elapsed_frames + 1;
+        auto due = origin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(next / fps));
+        {
+            std::unique_lock lock(d_->mutex);
+            if (d_->wake.wait_until(lock, due - kSpinMargin, [this] { return !d_->running; })) {
+                return;
+            }
+        }
+        while (Clock::now() < due) {
+            std::this_thread::yield();
+        }
+
+        auto now = Clock::now();
+        qint64 lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+        // 迟到超过一帧时直接跳到当前应到的帧，不补发中间的帧
+        qint64 reached = qMax(next, static_cast<qint64>(std::chrono::duration<double>(now - origin).count() * fps));
+
+        d_->tick_count.fetch_add(1, std::memory_order_relaxed);
+        d_->skipped_frames.fetch_add(reached - next, std::memory_order_relaxed);
+        d_->last_lateness_ns.store(lateness, std::memory_order_relaxed);
+        d_->total_lateness_ns.fetch_add(lateness, std::memory_order_relaxed);
+        if (lateness > d_->max_lateness_ns.load(std::memory_order_relaxed)) {
+            d_->max_lateness_ns.store(lateness, std::memory_order_relaxed);
+        }
+
+        elapsed_frames = reached;
+        qint64 frame = qMin(start_frame + reached, end_frame);
+        if (d_->latest_frame.exchange(frame, std::memory_order_acq_rel) != kNoTick) {
+            d_->dropped_ticks.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (frame >= end_frame) {
+            return;
+        }
+    }
+}
+
+void QmTimelinePlaybackClock::drainTicks()
+{
+    // 只取最新的帧，一次刷新中到达的多个tick合并为一次界面更新
+    qint64 frame = d_->latest_frame.exchange(kNoTick, std::memory_order_acq_rel);
+    if (frame == kNoTick || frame == d_->frame) {
+        return;
+    }
+    d_->frame = frame;
+    if (d_->cursor) {
+        d_->cursor->advanceTo(frame);
+    }
+    if (d_->view) {
+        d_->view->movePlayhead(frame);
+    }
+    emit frameChanged(frame);
+    if (frame >= d_->end_frame) {
+        stop();
+        emit finished();
+    }
+}
+
+void QmTimelinePlaybackClock::onFpsChanged(double)
+{
+    if (isRunning()) {
+        start(d_->frame);
+    }
+}
+
+} // namespace qmtl
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <QObject>
+
+namespace qmtl {
+
+class QmTimelineItemModel;
+class QmTimelineView;
+class QmTimelinePlaybackCursor;
+
+// 时钟线程的计时统计，迟到时间为实际唤醒时刻与该帧应到时刻之差
+struct QmTimelinePlaybackStatistics {
+    quint64 ticks { 0 };
+    // 线程迟到超过一帧时直接跳到当前帧，中间未发出的帧数
+    quint64 skipped_frames { 0 };
+    // GUI线程来不及取走，被更新的tick覆盖的tick
+    quint64 dropped_ticks { 0 };
+    qint64 last_lateness_ns { 0 };
+    qint64 max_lateness_ns { 0 };
+    double mean_lateness_ns { 0 };
+};
+
+struct QmTimelinePlaybackClockPrivate;
+// 播放时钟。
+// 独立线程按单调时钟和模型的fps推进帧号，写入原子的最新帧槽位交给GUI线程；
+// GUI线程按屏幕刷新率取出最新的帧，每次刷新最多更新一次播头和播放游标。
+class QMTIMELINE_LIB_EXPORT QmTimelinePlaybackClock : public QObject {
+    Q_OBJECT
+public:
+    explicit QmTimelinePlaybackClock(QmTimelineItemModel* model, QObject* parent = nullptr);
+    ~QmTimelinePlaybackClock() noexcept override;
+
+    // 播放时移动该视图的播头
+    void setView(QmTimelineView* view);
+    // 播放时推进该游标
+    void setCursor(QmTimelinePlaybackCursor* cursor);
+
+    // 从frame开始播放，到达模型的最大帧时停止
+    void start(qint64 frame);
+    void stop();
+    bool isRunning() const;
+    // GUI线程最近一次取出的帧
+    qint64 frame() const;
+
+    QmTimelinePlaybackStatistics statistics() const;
+    void resetStatistics();
+
+signals:
+    void frameChanged(qint64 frame);
+    void finished();
+
+private:
+    void run(qint64 start_frame, double fps);
+    void drainTicks();
+    void onFpsChanged(double fps);
+
+private:
+    QmTimelinePlaybackClockPrivate* d_ { nullptr };
+};
+
+} // namespace qmtl
@@ -0,0 +1,260 @@
+#include "qmtimelineplaybackcursor.h"
+#include "qmtimelineitem.h"
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinerowindex.h"
+#include <map>
+#include <queue>
+#include <set>
+
+namespace qmtl {
+
+struct QmTimelinePlaybackCursorPrivate {
+    struct RowCursor {
+        // 第一个end >= 当前帧的位置
+        qsizetype pos { 0 };
+        QmItemID active { kInvalidItemID };
+        // 每次重新定位后递增，用于识别堆中过期的事件
+        quint32 stamp { 0 };
+    };
+
+    struct Event {
+        qint64 frame { 0 };
+        int row_id { -1 };
+        quint32 stamp { 0 };
+
+        bool operator>(const Event& other) const
+        {
+            return frame > other.frame || (frame == other.frame && row_id > other.row_id);
+        }
+    };
+
+    QmTimelineItemModel* model { nullptr };
+    qint64 frame { 0 };
+    std::map<int, RowCursor> rows;
+    std::set<int> dirty_rows;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+};
+
+QmTimelinePlaybackCursor::QmTimelinePlaybackCursor(QmTimelineItemModel* model, QObject* parent)
+    : QObject(parent)
+    , d_(new QmTimelinePlaybackCursorPrivate)
+{
+    d_->model = model;
+    connect(model, &QmTimelineItemModel::itemCreated, this, &QmTimelinePlaybackCursor::invalidateItem);
+    connect(model, &QmTimelineItemModel::itemRemoved, this, &QmTimelinePlaybackCursor::invalidateItem);
+    connect(model, &QmTimelineItemModel::itemChanged, this, [this](QmItemID item_id, int role) {
+        if (role & (QmTimelineItem::StartRole | QmTimelineItem::DurationRole)) {
+            invalidateItem(item_id);
+        }
+    });
+    connect(model, &QmTimelineItemModel::itemsBatchChanged, this, [this](const QmItemBatchChange& change) {
+        for (int row_id : change.rows) {
+            invalidateRow(row_id);
+        }
+    });
+    // 波纹编辑、多选平移和帧率转换不逐个发出itemChanged
+    connect(model, &QmTimelineItemModel::itemsRippled, this, [this](int row_id) {
+        if (row_id < 0) {
+            invalidateAllRows();
+        } else {
+            invalidateRow(row_id);
+        }
+    });
+    connect(model, &QmTimelineItemModel::itemsMoved, this, [this](const std::vector<QmItemID>& item_ids) {
+        std::set<int> row_ids;
+        for (auto item_id : item_ids) {
+            row_ids.insert(QmTimelineItemModel::itemRowId(item_id));
+        }
+        for (int row_id : row_ids) {
+            invalidateRow(row_id);
+        }
+    });
+    connect(model, &QmTimelineItemModel::itemsRetimed, this, &QmTimelinePlaybackCursor::invalidateAllRows);
+
+    // 第一次advanceTo/seek时定位所有行
+    for (int row_id : model->rowIds()) {
+        d_->dirty_rows.insert(row_id);
+    }
+}
+
+QmTimelinePlaybackCursor::~QmTimelinePlaybackCursor() noexcept
+{
+    delete d_;
+}
+
+QmTimelineItemModel* QmTimelinePlaybackCursor::model() const
+{
+    return d_->model;
+}
+
+qint64 QmTimelinePlaybackCursor::frame() const
+{
+    return d_->frame;
+}
+
+void QmTimelinePlaybackCursor::advanceTo(qint64 frame)
+{
+    if (frame < d_->frame) {
+        seek(frame);
+        return;
+    }
+    // 失效的行先在原来的帧上重新定位，再参与推进
+    syncDirtyRows();
+    while (!d_->events.empty() && d_->events.top().frame <= frame) {
+        auto event = d_->events.top();
+        d_->events.pop();
+        auto it = d_->rows.find(event.row_id);
+        if (it == d_->rows.end() || it->second.stamp != event.stamp || d_->dirty_rows.contains(event.row_id)) {
+            continue;
+        }
+        processEvent(event.row_id, frame);
+    }
+    d_->frame = frame;
+}
+
+void QmTimelinePlaybackCursor::seek(qint64 frame)
+{
+    d_->frame = frame;
+    d_->events = {};
+    for (const auto& [row_id, _] : d_->rows) {
+        d_->dirty_rows.insert(row_id);
+    }
+    for (int row_id : d_->model->rowIds()) {
+        d_->dirty_rows.insert(row_id);
+    }
+    syncDirtyRows();
+}
+
+std::vector<QmItemID> QmTimelinePlaybackCursor::activeItems() const
+{
+    std::vector<QmItemID> result;
+    for (const auto& [_, cursor] : d_->rows) {
+        if (cursor.active != kInvalidItemID) {
+            result.push_back(cursor.active);
+        }
+    }
+    return result;
+}
+
+QmItemID QmTimelinePlaybackCursor::activeItem(int row_id) const
+{
+    auto it = d_->rows.find(row_id);
+    if (it == d_->rows.end()) {
+        return kInvalidItemID;
+    }
+    return it->second.active;
+}
+
+void QmTimelinePlaybackCursor::invalidateRow(int row_id)
+{
+    d_->dirty_rows.insert(row_id);
+    if (auto it = d_->rows.find(row_id); it != d_->rows.end()) {
+        ++it->second.stamp;
+    }
+}
+
+void QmTimelinePlaybackCursor::invalidateAllRows()
+{
+    for (const auto& [row_id, _] : d_->rows) {
+        invalidateRow(row_id);
+    }
+    for (int row_id : d_->model->rowIds()) {
+        invalidateRow(row_id);
+    }
+}
+
+void QmTimelinePlaybackCursor::invalidateItem(QmItemID item_id)
+{
+    invalidateRow(QmTimelineItemModel::itemRowId(item_id));
+}
+
+void QmTimelinePlaybackCursor::syncDirtyRows()
+{
+    // 信号处理中可能再次修改模型，逐个取出
+    while (!d_->dirty_rows.empty()) {
+        int row_id = *d_->dirty_rows.begin();
+        d_->dirty_rows.erase(d_->dirty_rows.begin());
+        syncRow(row_id);
+    }
+}
+
+void QmTimelinePlaybackCursor::syncRow(int row_id)
+{
+    const auto* index = d_->model->rowIndex(row_id);
+    QmItemID old_active = kInvalidItemID;
+    QmItemID new_active = kInvalidItemID;
+    if (auto it = d_->rows.find(row_id); it != d_->rows.end()) {
+        old_active = it->second.active;
+    }
+    if (!index) {
+        d_->rows.erase(row_id);
+    } else {
+        auto& cursor = d_->rows[row_id];
+        ++cursor.stamp;
+        cursor.pos = index->lowerBoundEnd(d_->frame);
+        if (cursor.pos < index->size() && index->startAt(cursor.pos) <= d_->frame) {
+            new_active = index->idAt(cursor.pos);
+        }
+        cursor.active = new_active;
+        scheduleRow(row_id);
+    }
+
+    if (old_active == new_active) {
+        return;
+    }
+    if (old_active != kInvalidItemID) {
+        emit itemExited(old_active);
+    }
+    if (new_active != kInvalidItemID) {
+        emit itemEntered(new_active);
+    }
+}
+
+void QmTimelinePlaybackCursor::scheduleRow(int row_id)
+{
+    const auto* index = d_->model->rowIndex(row_id);
+    const auto& cursor = d_->rows[row_id];
+    if (!index || cursor.pos >= index->size()) {
+        return;
+    }
+    qint64 next_frame = 0;
+    if (cursor.active == kInvalidItemID) {
+        next_frame = index->startAt(cursor.pos);
+    } else if (index->endAt(cursor.pos) < std::numeric_limits<qint64>::max()) {
+        // 区间是闭区间，end的下一帧离开
+        next_frame = index->endAt(cursor.pos) + 1;
+    } else {
+        return;
+    }
+    d_->events.push({ next_frame, row_id, cursor.stamp });
+}
+
+void QmTimelinePlaybackCursor::processEvent(int row_id, qint64 target_frame)
+{
+    const auto* index = d_->model->rowIndex(row_id);
+    auto& cursor = d_->rows[row_id];
+    if (!index || cursor.pos >= index->size()) [[unlikely]] {
+        return;
+    }
+
+    QmItemID item_id = index->idAt(cursor.pos);
+    if (cursor.active != kInvalidItemID) {
+        cursor.active = kInvalidItemID;
+        ++cursor.pos;
+        scheduleRow(row_id);
+        emit itemExited(item_id);
+        return;
+    }
+    if (index->endAt(cursor.pos) < target_frame) {
+        // 在本次推进范围内开始又结束
+        ++cursor.pos;
+        scheduleRow(row_id);
+        emit itemSkipped(item_id);
+        return;
+    }
+    cursor.active = item_id;
+    scheduleRow(row_id);
+    emit itemEntered(item_id);
+}
+
+} // namespace qmtl
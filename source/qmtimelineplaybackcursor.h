@@ -0,0 +1,53 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <QObject>
+
+namespace qmtl {
+
+class QmTimelineItemModel;
+struct QmTimelinePlaybackCursorPrivate;
+// 播放游标，按帧推进时逐行扫描模型的行索引，通知item的进入、离开和被跨过。
+// 每行保存一个扫描位置，所有行下一次事件的帧号放在最小堆中：
+// advanceTo只处理发生的事件，O(events·log rows)；seek逐行二分查找，O(rows·log n)。
+// 模型修改后只将受影响的行标记为失效，在下一次advanceTo/seek时重新定位。
+class QMTIMELINE_LIB_EXPORT QmTimelinePlaybackCursor : public QObject {
+    Q_OBJECT
+public:
+    explicit QmTimelinePlaybackCursor(QmTimelineItemModel* model, QObject* parent = nullptr);
+    ~QmTimelinePlaybackCursor() noexcept override;
+
+    QmTimelineItemModel* model() const;
+    qint64 frame() const;
+
+    // 向后推进到frame，按帧的先后发出事件；frame小于当前帧时按seek处理
+    void advanceTo(qint64 frame);
+    // 跳转到frame，只比较跳转前后的活动item，不产生itemSkipped
+    void seek(qint64 frame);
+
+    // 当前帧处活动的item，按行号升序
+    std::vector<QmItemID> activeItems() const;
+    QmItemID activeItem(int row_id) const;
+
+signals:
+    void itemEntered(QmItemID item_id);
+    void itemExited(QmItemID item_id);
+    // 一次推进中完整跨过(开始和结束都在推进范围内)的item
+    void itemSkipped(QmItemID item_id);
+
+private:
+    void invalidateRow(int row_id);
+    void invalidateAllRows();
+    void invalidateItem(QmItemID item_id);
+    void syncDirtyRows();
+    // 将行定位到当前帧并与之前的活动item比较，发出进入/离开事件
+    void syncRow(int row_id);
+    void scheduleRow(int row_id);
+    void processEvent(int row_id, qint64 target_frame);
+
+private:
+    QmTimelinePlaybackCursorPrivate* d_ { nullptr };
+};
+
+} // namespace qmtl
@@ -0,0 +1,295 @@
+#include "qmtimelinerowindex.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace qmtl {
+
+namespace {
+// 无分支的lower_bound，循环体只有一次比较和条件移动
+qsizetype lowerBoundOf(const std::vector<qint64>& values, qint64 frame)
+{
+    qsizetype count = static_cast<qsizetype>(values.size());
+    if (count == 0) {
+        return 0;
+    }
+    const qint64* base = values.data();
+    while (count > 1) {
+        qsizetype half = count / 2;
+        base = base[half] < frame ? base + half : base;
+        count -= half;
+    }
+    return (base - values.data()) + (*base < frame ? 1 : 0);
+}
+
+template <typename T>
+void rotateOne(std::vector<T>& values, qsizetype from, qsizetype to)
+{
+    if (from < to) {
+        std::rotate(values.begin() + from, values.begin() + from + 1, values.begin() + to + 1);
+    } else {
+        std::rotate(values.begin() + to, values.begin() + from, values.begin() + from + 1);
+    }
+}
+} // namespace
+
+QmTimelineRowIndex::QmTimelineRowIndex()
+    : d_(new Data)
+{
+}
+
+qsizetype QmTimelineRowIndex::lowerBound(qint64 frame) const
+{
+    return lowerBoundOf(d_->starts, frame);
+}
+
+qsizetype QmTimelineRowIndex::upperBound(qint64 frame) const
+{
+    if (frame == std::numeric_limits<qint64>::max()) {
+        return size();
+    }
+    return lowerBoundOf(d_->starts, frame + 1);
+}
+
+qsizetype QmTimelineRowIndex::lowerBoundEnd(qint64 frame) const
+{
+    return lowerBoundOf(d_->ends, frame);
+}
+
+qsizetype QmTimelineRowIndex::find(QmItemID item_id, qint64 start) const
+{
+    qsizetype pos = lowerBound(start);
+    if (pos < size() && d_->starts[pos] == start && d_->ids[pos] == item_id) {
+        return pos;
+    }
+    return npos;
+}
+
+qsizetype QmTimelineRowIndex::findById(QmItemID item_id) const
+{
+    auto it = std::find(d_->ids.cbegin(), d_->ids.cend(), item_id);
+    if (it == d_->ids.cend()) {
+        return npos;
+    }
+    return static_cast<qsizetype>(it - d_->ids.cbegin());
+}
+
+bool QmTimelineRowIndex::isOccupied(qint64 start, qint64 end, QmItemID except_item) const
+{
+    // 与[start, end]相交的item在数组中是连续的一段，且从第一个end >= start的item开始
+    qsizetype pos = lowerBoundEnd(start);
+    if (pos < size() && d_->ids[pos] == except_item) {
+        ++pos;
+    }
+    return pos < size() && d_->starts[pos] <= end;
+}
+
+qsizetype QmTimelineRowIndex::stab(qint64 frame) const
+{
+    qsizetype pos = lowerBoundEnd(frame);
+    if (pos < size() && d_->starts[pos] <= frame) {
+        return pos;
+    }
+    return npos;
+}
+
+QmTimelineRowRange QmTimelineRowIndex::overlapping(qint64 from, qint64 to) const
+{
+    // 区间互不重叠，end >= from的第一个item之后、start <= to的最后一个item之前都与[from, to]相交
+    qsizetype first = lowerBoundEnd(from);
+    qsizetype last = upperBound(to);
+    return QmTimelineRowRange(this, first, std::max(first, last));
+}
+
+QmTimelineRowRange QmTimelineRowIndex::all() const
+{
+    return QmTimelineRowRange(this, 0, size());
+}
+
+qsizetype QmTimelineRowIndex::insert(QmItemID item_id, qint64 start, qint64 end)
+{
+    qsizetype pos = lowerBound(start);
+    d_->starts.insert(d_->starts.begin() + pos, start);
+    d_->ends.insert(d_->ends.begin() + pos, end);
+    d_->ids.insert(d_->ids.begin() + pos, item_id);
+    return pos;
+}
+
+void QmTimelineRowIndex::erase(qsizetype pos)
+{
+    d_->starts.erase(d_->starts.begin() + pos);
+    d_->ends.erase(d_->ends.begin() + pos);
+    d_->ids.erase(d_->ids.begin() + pos);
+}
+
+void QmTimelineRowIndex::erase(const std::vector<qsizetype>& positions)
+{
+    if (positions.empty()) {
+        return;
+    }
+    auto& data = *d_;
+    // 从第一个删除位置开始把保留的元素依次前移
+    qsizetype write = positions.front();
+    auto next = positions.cbegin();
+    for (qsizetype read = positions.front(); read < size(); ++read) {
+        if (next != positions.cend() && *next == read) {
+            ++next;
+            continue;
+        }
+        data.starts[write] = data.starts[read];
+        data.ends[write] = data.ends[read];
+        data.ids[write] = data.ids[read];
+        ++write;
+    }
+    data.starts.resize(write);
+    data.ends.resize(write);
+    data.ids.resize(write);
+}
+
+void QmTimelineRowIndex::insert(std::vector<QmTimelineRowRange::Entry> entries)
+{
+    if (entries.empty()) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.start < b.start; });
+    auto& data = *d_;
+    qsizetype read = size() - 1;
+    qsizetype write = size() + static_cast<qsizetype>(entries.size()) - 1;
+    data.starts.resize(write + 1);
+    data.ends.resize(write + 1);
+    data.ids.resize(write + 1);
+    // 从末尾开始，现有元素每个最多后移一次，第一个插入位置之前的元素不动
+    for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+        while (read >= 0 && data.starts[read] > it->start) {
+            data.starts[write] = data.starts[read];
+            data.ends[write] = data.ends[read];
+            data.ids[write] = data.ids[read];
+            --read;
+            --write;
+        }
+        data.starts[write] = it->start;
+        data.ends[write] = it->end;
+        data.ids[write] = it->id;
+        --write;
+    }
+}
+
+qsizetype QmTimelineRowIndex::move(qsizetype pos, qint64 start, qint64 end)
+{
+    qsizetype target = lowerBound(start);
+    // lowerBound把自身也计算在内，向后移动时需要减去
+    if (target > pos) {
+        --target;
+    }
+    if (target != pos) {
+        rotateOne(d_->starts, pos, target);
+        rotateOne(d_->ends, pos, target);
+        rotateOne(d_->ids, pos, target);
+    }
+    d_->starts[target] = start;
+    d_->ends[target] = end;
+    return target;
+}
+
+void QmTimelineRowIndex::setEnd(qsizetype pos, qint64 end)
+{
+    d_->ends[pos] = end;
+}
+
+void QmTimelineRowIndex::shift(const std::vector<qsizetype>& positions, qint64 delta)
+{
+    auto& data = *d_;
+    for (qsizetype pos : positions) {
+        data.starts[pos] += delta;
+        data.ends[pos] += delta;
+    }
+}
+
+void QmTimelineRowIndex::shiftFrom(qsizetype pos, qint64 delta)
+{
+    auto& data = *d_;
+    // 连续数组上的简单加法，编译器可以向量化
+    for (auto it = data.starts.begin() + pos; it != data.starts.end(); ++it) {
+        *it += delta;
+    }
+    for (auto it = data.ends.begin() + pos; it != data.ends.end(); ++it) {
+        *it += delta;
+    }
+}
+
+void QmTimelineRowIndex::assignSpans(std::vector<qint64> starts, std::vector<qint64> ends)
+{
+    Q_ASSERT(starts.size() == d_->ids.size() && ends.size() == d_->ids.size());
+    auto& data = *d_;
+    data.starts = std::move(starts);
+    data.ends = std::move(ends);
+}
+
+void QmTimelineRowIndex::append(QmItemID item_id, qint64 start, qint64 end)
+{
+    d_->starts.push_back(start);
+    d_->ends.push_back(end);
+    d_->ids.push_back(item_id);
+}
+
+void QmTimelineRowIndex::sort()
+{
+    const Data& src = *std::as_const(d_);
+    if (std::is_sorted(src.starts.cbegin(), src.starts.cend())) {
+        return;
+    }
+    std::vector<qsizetype> order(src.starts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&src](qsizetype lhs, qsizetype rhs) { return src.starts[lhs] < src.starts[rhs]; });
+
+    // 重排后的数据写入新的共享块，不影响仍引用旧数据的副本
+    auto* sorted = new Data;
+    sorted->starts.resize(order.size());
+    sorted->ends.resize(order.size());
+    sorted->ids.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted->starts[i] = src.starts[order[i]];
+        sorted->ends[i] = src.ends[order[i]];
+        sorted->ids[i] = src.ids[order[i]];
+    }
+    d_.reset(sorted);
+}
+
+void QmTimelineRowIndex::clear()
+{
+    d_.reset(new Data);
+}
+
+QmTimelineRowRange::QmTimelineRowRange(const QmTimelineRowIndex* index, qsizetype first, qsizetype last)
+    : index_(index)
+    , first_(first)
+    , last_(last)
+{
+}
+
+std::span<const QmItemID> QmTimelineRowRange::ids() const
+{
+    if (!index_) {
+        return {};
+    }
+    return std::span<const QmItemID>(index_->d_->ids).subspan(first_, size());
+}
+
+std::span<const qint64> QmTimelineRowRange::starts() const
+{
+    if (!index_) {
+        return {};
+    }
+    return std::span<const qint64>(index_->d_->starts).subspan(first_, size());
+}
+
+std::span<const qint64> QmTimelineRowRange::ends() const
+{
+    if (!index_) {
+        return {};
+    }
+    return std::span<const qint64>(index_->d_->ends).subspan(first_, size());
+}
+
+} // namespace qmtl
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <QSharedData>
+#include <iterator>
+#include <span>
+#include <vector>
+
+namespace qmtl {
+
+class QmTimelineRowIndex;
+
+// 行索引中位置[first, last)的只读视图，不复制数据。
+// 与迭代器一样，行索引被修改(创建、删除、移动item)后视图失效，需要重新查询。
+class QMTIMELINE_LIB_EXPORT QmTimelineRowRange {
+public:
+    struct Entry {
+        QmItemID id { kInvalidItemID };
+        qint64 start { 0 };
+        qint64 end { 0 };
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = qsizetype;
+        using pointer = void;
+        using reference = Entry;
+
+        const_iterator() = default;
+        inline Entry operator*() const;
+        inline const_iterator& operator++();
+        inline const_iterator operator++(int);
+        bool operator==(const const_iterator& other) const = default;
+
+    private:
+        friend class QmTimelineRowRange;
+        const_iterator(const QmTimelineRowIndex* index, qsizetype pos)
+            : index_(index)
+            , pos_(pos)
+        {
+        }
+
+        const QmTimelineRowIndex* index_ { nullptr };
+        qsizetype pos_ { 0 };
+    };
+
+    QmTimelineRowRange() = default;
+    QmTimelineRowRange(const QmTimelineRowIndex* index, qsizetype first, qsizetype last);
+
+    inline const_iterator begin() const;
+    inline const_iterator end() const;
+    inline qsizetype size() const;
+    inline bool empty() const;
+    // 视图中第一个item在行中的位置
+    inline qsizetype first() const;
+    inline Entry operator[](qsizetype i) const;
+
+    std::span<const QmItemID> ids() const;
+    std::span<const qint64> starts() const;
+    std::span<const qint64> ends() const;
+
+private:
+    const QmTimelineRowIndex* index_ { nullptr };
+    qsizetype first_ { 0 };
+    qsizetype last_ { 0 };
+};
+
+// 跨行查询的结果
+struct QmTimelineRowSlice {
+    int row_id { -1 };
+    QmTimelineRowRange items;
+};
+
+// 单行item的区间索引。
+// item按start升序存放在连续的start/end/id数组中，数组下标即item在行内的序位(rank)。
+// 同一行的item区间[start, end]互不重叠，因此end同样升序，邻居、占用判断都只需二分查找。
+class QMTIMELINE_LIB_EXPORT QmTimelineRowIndex {
+public:
+    static constexpr qsizetype npos = -1;
+
+    QmTimelineRowIndex();
+
+    inline qsizetype size() const;
+    inline bool empty() const;
+
+    inline qint64 startAt(qsizetype pos) const;
+    inline qint64 endAt(qsizetype pos) const;
+    inline QmItemID idAt(qsizetype pos) const;
+
+    // 第一个start >= frame的位置
+    qsizetype lowerBound(qint64 frame) const;
+    // 第一个start > frame的位置
+    qsizetype upperBound(qint64 frame) const;
+    // 第一个end >= frame的位置
+    qsizetype lowerBoundEnd(qint64 frame) const;
+
+    // 按start定位item，找不到时返回npos
+    qsizetype find(QmItemID item_id, qint64 start) const;
+    // 线性查找，仅用于索引与item数据不同步时的兜底
+    qsizetype findById(QmItemID item_id) const;
+
+    // 包含frame的item的位置(区间互不重叠，最多一个)，没有时返回npos
+    qsizetype stab(qint64 frame) const;
+    // 与[from, to]有交集的item，O(log n)
+    QmTimelineRowRange overlapping(qint64 from, qint64 to) const;
+    QmTimelineRowRange all() const;
+
+    // [start, end]是否与除except_item以外的item重叠
+    bool isOccupied(qint64 start, qint64 end, QmItemID except_item = kInvalidItemID) const;
+
+    // 二分定位O(log n)，插入/删除需要搬移其后的元素，O(n)
+    qsizetype insert(QmItemID item_id, qint64 start, qint64 end);
+    void erase(qsizetype pos);
+    // 一次删除多个位置，positions升序且不重复，O(n)
+    void erase(const std::vector<qsizetype>& positions);
+    // 一次插入多个与现有item互不重叠的区间，从后向前归并，O(n + k log k)
+    void insert(std::vector<QmTimelineRowRange::Entry> entries);
+    // 修改pos处item的区间，返回item新的位置
+    qsizetype move(qsizetype pos, qint64 start, qint64 end);
+    void setEnd(qsizetype pos, qint64 end);
+    // 平移多个位置的区间，调用者保证平移后顺序不变且互不重叠
+    void shift(const std::vector<qsizetype>& positions, qint64 delta);
+    // 平移[pos, size())的所有区间，顺序不变
+    void shiftFrom(qsizetype pos, qint64 delta);
+    // 替换所有区间，调用者保证与现有item一一对应、顺序不变且互不重叠
+    void assignSpans(std::vector<qint64> starts, std::vector<qint64> ends);
+
+    // 批量构建：先追加，再统一排序
+    void append(QmItemID item_id, qint64 start, qint64 end);
+    void sort();
+    void clear();
+
+private:
+    friend class QmTimelineRowRange;
+    struct Data : public QSharedData {
+        std::vector<qint64> starts;
+        std::vector<qint64> ends;
+        std::vector<QmItemID> ids;
+    };
+    // 隐式共享，复制索引(例如模型快照)是O(1)的，修改时才复制数据
+    QSharedDataPointer<Data> d_;
+};
+
+inline qsizetype QmTimelineRowIndex::size() const
+{
+    return static_cast<qsizetype>(d_->ids.size());
+}
+
+inline bool QmTimelineRowIndex::empty() const
+{
+    return d_->ids.empty();
+}
+
+inline qint64 QmTimelineRowIndex::startAt(qsizetype pos) const
+{
+    return d_->starts[pos];
+}
+
+inline qint64 QmTimelineRowIndex::endAt(qsizetype pos) const
+{
+    return d_->ends[pos];
+}
+
+inline QmItemID QmTimelineRowIndex::idAt(qsizetype pos) const
+{
+    return d_->ids[pos];
+}
+
+inline QmTimelineRowRange::Entry QmTimelineRowRange::const_iterator::operator*() const
+{
+    return { index_->idAt(pos_), index_->startAt(pos_), index_->endAt(pos_) };
+}
+
+inline QmTimelineRowRange::const_iterator& QmTimelineRowRange::const_iterator::operator++()
+{
+    ++pos_;
+    return *this;
+}
+
+inline QmTimelineRowRange::const_iterator QmTimelineRowRange::const_iterator::operator++(int)
+{
+    auto result = *this;
+    ++pos_;
+    return result;
+}
+
+inline QmTimelineRowRange::const_iterator QmTimelineRowRange::begin() const
+{
+    return { index_, first_ };
+}
+
+inline QmTimelineRowRange::const_iterator QmTimelineRowRange::end() const
+{
+    return { index_, last_ };
+}
+
+inline qsizetype QmTimelineRowRange::size() const
+{
+    return last_ - first_;
+}
+
+inline bool QmTimelineRowRange::empty() const
+{
+    return last_ == first_;
+}
+
+inline qsizetype QmTimelineRowRange::first() const
+{
+    return first_;
+}
+
+inline QmTimelineRowRange::Entry QmTimelineRowRange::operator[](qsizetype i) const
+{
+    return *const_iterator(index_, first_ + i);
+}
+
+} // namespace qmtl
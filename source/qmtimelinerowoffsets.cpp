@@ -0,0 +1,49 @@
+#include "qmtimelinerowoffsets.h"
+
+namespace qmtl {
+
+bool QmTimelineRowOffsets::setHeight(int row_id, qreal height)
+{
+    if (row_id < 0 || row_id >= kRowCount) [[unlikely]] {
+        return false;
+    }
+    qreal delta = height - heights_[row_id];
+    if (qFuzzyIsNull(delta)) {
+        return false;
+    }
+    heights_[row_id] = height;
+    for (int i = row_id + 1; i <= kRowCount; i += i & -i) {
+        tree_[i] += delta;
+    }
+    return true;
+}
+
+qreal QmTimelineRowOffsets::height(int row_id) const
+{
+    if (row_id < 0 || row_id >= kRowCount) [[unlikely]] {
+        return 0;
+    }
+    return heights_[row_id];
+}
+
+qreal QmTimelineRowOffsets::offset(int row_id) const
+{
+    qreal result = 0;
+    for (int i = qBound(0, row_id, kRowCount); i > 0; i -= i & -i) {
+        result += tree_[i];
+    }
+    return result;
+}
+
+qreal QmTimelineRowOffsets::totalHeight() const
+{
+    return offset(kRowCount);
+}
+
+void QmTimelineRowOffsets::clear()
+{
+    heights_.fill(0);
+    tree_.fill(0);
+}
+
+} // namespace qmtl
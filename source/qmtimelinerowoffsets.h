@@ -0,0 +1,32 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include <QtGlobal>
+#include <array>
+
+namespace qmtl {
+
+// 各行的纵向偏移。
+// 以树状数组(Fenwick tree)维护每行占用的高度，修改一行高度和查询一行之前所有行的高度之和都是O(log n)。
+// 行号范围与QmItemID中的行字段一致，为[0, kRowCount)。
+class QMTIMELINE_LIB_EXPORT QmTimelineRowOffsets {
+public:
+    static constexpr int kRowCount = 256;
+
+    // 设置行占用的高度，隐藏或没有item的行为0，返回高度是否改变
+    bool setHeight(int row_id, qreal height);
+    qreal height(int row_id) const;
+
+    // 行号小于row_id的所有行的高度之和
+    qreal offset(int row_id) const;
+    qreal totalHeight() const;
+
+    void clear();
+
+private:
+    std::array<qreal, kRowCount> heights_ {};
+    // tree_[i]保存heights_[i - lowbit(i), i)之和，下标从1开始
+    std::array<qreal, kRowCount + 1> tree_ {};
+};
+
+} // namespace qmtl
@@ -4,18 +4,58 @@
 #include "qmtimelineitemfactory.h"
 #include "qmtimelineitemmodel.h"
 #include "qmtimelineitemview.h"
+#include "qmtimelinerowindex.h"
 #include "qmtimelinetype.h"
 #include "qmtimelineview.h"
 #include <QGraphicsSceneContextMenuEvent>
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
 #include <QUndoStack>
 
 namespace qmtl {
+
+namespace {
+// 每种item类型最多缓存的空闲视图数量
+constexpr qsizetype kMaxPooledViews = 256;
+
+// 行中与范围相交的item的位置区间[first, last)
+std::pair<qsizetype, qsizetype> liveSpan(const QmTimelineRowIndex& index, const std::array<qint64, 2>& range)
+{
+    return { index.lowerBoundEnd(range[0]), index.upperBound(range[1]) };
+}
+
+// 区间[first, last)两侧紧邻的item，没有时为kInvalidItemID
+std::array<QmItemID, 2> spanEdges(const QmTimelineRowIndex& index, qsizetype first, qsizetype last)
+{
+    return { first > 0 ? index.idAt(first - 1) : kInvalidItemID, last < index.size() ? index.idAt(last) : kInvalidItemID };
+}
+} // namespace
+
 struct QmTimelineScenePrivate {
     QmTimelineView* view { nullptr };
     QmTimelineItemModel* model { nullptr };
     QUndoStack* undo_stack { nullptr };
     std::unordered_map<QmItemID, std::unique_ptr<QmTimelineItemView>> item_views;
     std::unordered_map<QmItemConnID, std::unique_ptr<QmTimelineItemConnView>, QmItemConnIDHash, QmItemConnIDEqual> item_conn_views;
+    // {item_type: 已移出场景的空闲视图}
+    std::unordered_map<int, std::vector<std::unique_ptr<QmTimelineItemView>>> view_pool;
+    std::array<qint64, 2> live_range { 0, -1 };
+    // {row_id: 范围两侧各多保留视图的一个item}，使跨出范围的连接线两端都有视图
+    std::unordered_map<int, std::array<QmItemID, 2>> row_edges;
+    bool fit_scheduled { false };
+    QmShadowMode shadow_mode { QmShadowMode::Cached };
+    // 多选拖动开始时各item的start
+    std::map<QmItemID, qint64> drag_old_starts;
+
+    QmSnapTargets snap_targets;
+    qreal snap_tolerance { 8 };
+    // 拖动期间其他item的边缘，第一次拖动时建立，释放时清空
+    QmTimelineSnapIndex snap_index;
+    // 按下时记录的被拖动的item，升序
+    std::vector<QmItemID> snap_excluded;
+    bool snap_index_built { false };
+    bool snapping { false };
+    QLineF snap_guide;
 };
 
 QmTimelineScene::QmTimelineScene(QmTimelineItemModel* model, QObject* parent)
@@ -28,9 +68,14 @@ QmTimelineScene::QmTimelineScene(QmTimelineItemModel* model, QObject* parent)
     connect(model, &QmTimelineItemModel::itemRemoved, this, &QmTimelineScene::onItemRemoved);
     connect(model, &QmTimelineItemModel::itemOperateFinished, this, &QmTimelineScene::onItemOperateFinished);
     connect(model, &QmTimelineItemModel::requestUpdateItemY, this, &QmTimelineScene::onUpdateItemYRequested);
+    connect(model, &QmTimelineItemModel::rowsYChanged, this, &QmTimelineScene::onRowsYChanged);
+    connect(model, &QmTimelineItemModel::itemsRippled, this, [this](int row_id) { onItemsRippled(row_id); });
+    connect(model, &QmTimelineItemModel::itemsMoved, this, &QmTimelineScene::onItemsMoved);
+    connect(model, &QmTimelineItemModel::itemsRetimed, this, [this] { onItemsRippled(-1); });
 
     connect(model, &QmTimelineItemModel::itemConnCreated, this, &QmTimelineScene::onItemConnCreated);
     connect(model, &QmTimelineItemModel::itemConnRemoved, this, &QmTimelineScene::onItemConnRemoved);
+    connect(model, &QmTimelineItemModel::itemsBatchChanged, this, &QmTimelineScene::onItemsBatchChanged);
     connect(model, &QmTimelineItemModel::requestRefreshItemViewCache, this, &QmTimelineScene::onRefreshItemViewCacheRequested);
     connect(model, &QmTimelineItemModel::requestRebuildItemViewCache, this, &QmTimelineScene::onRebuildItemViewCacheRequested);
 }
@@ -40,6 +85,26 @@ QmTimelineScene::~QmTimelineScene() noexcept
     delete d_;
 }
 
+void QmTimelineScene::setShadowMode(QmShadowMode mode)
+{
+    if (mode == d_->shadow_mode) {
+        return;
+    }
+    d_->shadow_mode = mode;
+    // 对象池中的视图在复用时再切换
+    for (auto& [item_id, item_view] : d_->item_views) {
+        item_view->setShadowMode(mode);
+    }
+    for (auto& [conn_id, conn_view] : d_->item_conn_views) {
+        conn_view->setShadowMode(mode);
+    }
+}
+
+QmShadowMode QmTimelineScene::shadowMode() const
+{
+    return d_->shadow_mode;
+}
+
 void QmTimelineScene::setView(QmTimelineView* view)
 {
     d_->view = view;
@@ -120,12 +185,62 @@ qreal QmTimelineScene::axisFramePixels() const
 
 void QmTimelineScene::fitInAxis()
 {
-    for (const auto& [_, item] : d_->item_views) {
-        item->fitInAxis();
+    d_->fit_scheduled = false;
+    if (calcLiveRange() != d_->live_range) {
+        updateLiveViews();
     }
 
-    for (const auto& [_, conn] : d_->item_conn_views) {
-        conn->fitInAxis();
+    // 沿行索引只遍历范围内的item，连接线随起点item一起更新
+    for (int row_id : model()->rowIds()) {
+        const auto* index = model()->rowIndex(row_id);
+        if (!index) {
+            continue;
+        }
+        auto [first, last] = liveSpan(*index, d_->live_range);
+        for (qsizetype pos = first; pos < last; ++pos) {
+            fitItemInAxis(index->idAt(pos));
+        }
+    }
+    for (const auto& [_, edges] : d_->row_edges) {
+        for (auto item_id : edges) {
+            fitItemInAxis(item_id);
+        }
+    }
+
+    // 选中后保留在范围外的视图
+    for (auto* item : QGraphicsScene::selectedItems()) {
+        if (item->type() == QmTimelineItemView::Type) {
+            fitItemInAxis(static_cast<QmTimelineItemView*>(item)->itemId());
+        }
+    }
+}
+
+void QmTimelineScene::scheduleFitInAxis()
+{
+    // 可视范围的最小值和最大值通常成对改变，合并为一次布局
+    if (d_->fit_scheduled) {
+        return;
+    }
+    d_->fit_scheduled = true;
+    QMetaObject::invokeMethod(
+        this,
+        [this] {
+            if (d_->fit_scheduled) {
+                fitInAxis();
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void QmTimelineScene::fitItemInAxis(QmItemID item_id)
+{
+    auto* item_view = itemView(item_id);
+    if (!item_view) {
+        return;
+    }
+    item_view->fitInAxis();
+    if (auto* conn_view = itemConnView(model()->nextConnection(item_id)); conn_view) {
+        conn_view->fitInAxis();
     }
 }
 
@@ -154,16 +269,418 @@ void QmTimelineScene::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
     emit requestSceneContextMenu();
 }
 
+void QmTimelineScene::mousePressEvent(QGraphicsSceneMouseEvent* event)
+{
+    QGraphicsScene::mousePressEvent(event);
+    d_->drag_old_starts.clear();
+    // 按下时选择已经更新，按住多选中的item开始拖动
+    auto* grabber = mouseGrabberItem();
+    if (!grabber || grabber->type() != QmTimelineItemView::Type) {
+        return;
+    }
+    auto selected_ids = selectedItems();
+    bool is_group = selected_ids.size() > 1 && grabber->isSelected();
+    if (d_->snap_targets) {
+        if (is_group) {
+            beginSnap({ selected_ids.begin(), selected_ids.end() });
+        } else {
+            beginSnap({ static_cast<QmTimelineItemView*>(grabber)->itemId() });
+        }
+    }
+    if (!is_group) {
+        return;
+    }
+    for (auto item_id : selected_ids) {
+        if (auto* item = model()->item(item_id); item) {
+            d_->drag_old_starts.emplace(item_id, item->start());
+        }
+    }
+}
+
+void QmTimelineScene::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
+{
+    QGraphicsScene::mouseReleaseEvent(event);
+    endSnap();
+    if (d_->drag_old_starts.empty()) {
+        return;
+    }
+    auto old_starts = std::exchange(d_->drag_old_starts, {});
+    std::erase_if(old_starts, [this](const auto& pair) {
+        auto* item = model()->item(pair.first);
+        return !item || item->start() == pair.second;
+    });
+    if (!old_starts.empty()) {
+        emit itemsMoveFinished(old_starts);
+    }
+}
+
+void QmTimelineScene::drawForeground(QPainter* painter, const QRectF& rect)
+{
+    QGraphicsScene::drawForeground(painter, rect);
+    if (d_->snap_guide.isNull()) {
+        return;
+    }
+    painter->save();
+    // 宽度为0的笔不随缩放变粗
+    painter->setPen(QPen(Qt::yellow, 0, Qt::DashLine));
+    painter->drawLine(d_->snap_guide);
+    painter->restore();
+}
+
+void QmTimelineScene::setSnapTargets(QmSnapTargets targets)
+{
+    d_->snap_targets = targets;
+    if (!targets) {
+        endSnap();
+    }
+}
+
+QmSnapTargets QmTimelineScene::snapTargets() const
+{
+    return d_->snap_targets;
+}
+
+void QmTimelineScene::setSnapTolerance(qreal pixels)
+{
+    d_->snap_tolerance = qMax(0.0, pixels);
+}
+
+qreal QmTimelineScene::snapTolerance() const
+{
+    return d_->snap_tolerance;
+}
+
+QmSnapResult QmTimelineScene::snapItemStart(QmItemID item_id, qint64 start)
+{
+    QmSnapResult result { .start = start };
+    auto* item = model()->item(item_id);
+    if (!item || !d_->snap_targets || !d_->view) {
+        setSnapGuide({});
+        return result;
+    }
+    // 不在拖动中调用时以item自身建立索引，直到下一次鼠标释放
+    if (!d_->snapping) {
+        beginSnap({ item_id });
+    }
+
+    if ((d_->snap_targets & QmSnapTarget::ItemEdge) && !d_->snap_index_built) {
+        d_->snap_index.build(*model(), d_->snap_excluded);
+        d_->snap_index_built = true;
+    }
+
+    const qint64 tolerance = static_cast<qint64>(d_->snap_tolerance / axisFramePixels());
+    const qint64 duration = item->duration();
+    const qint64 view_min = model()->viewFrameMinimum();
+    const qint64 view_max = model()->viewFrameMaximum();
+    qint64 best_distance = tolerance + 1;
+    // 距离相同时先尝试的目标优先：先开始后结束，item边缘、播头、刻度依次排列
+    auto consider = [&](qint64 edge, qint64 frame, QmSnapTarget target, QmItemID target_id) {
+        qint64 distance = qAbs(frame - edge);
+        qint64 new_start = start + frame - edge;
+        if (distance >= best_distance || new_start < view_min || new_start + duration > view_max) {
+            return;
+        }
+        best_distance = distance;
+        result.start = new_start;
+        result.target = target;
+        result.frame = frame;
+        result.item_id = target_id;
+    };
+    for (qint64 edge : { start, start + duration }) {
+        if (d_->snap_targets & QmSnapTarget::ItemEdge) {
+            if (const auto* nearest = d_->snap_index.nearest(edge, tolerance); nearest) {
+                consider(edge, nearest->frame, QmSnapTarget::ItemEdge, nearest->item_id);
+            }
+        }
+        if (d_->snap_targets & QmSnapTarget::Playhead) {
+            consider(edge, d_->view->axisFrameNo(), QmSnapTarget::Playhead, kInvalidItemID);
+        }
+        if (d_->snap_targets & QmSnapTarget::RulerTick) {
+            // 刻度从可视范围的最小帧开始等间距排列，最近的刻度直接计算
+            qint64 step = d_->view->axisTickFrames();
+            qint64 tick = view_min + qRound64(static_cast<double>(edge - view_min) / step) * step;
+            consider(edge, tick, QmSnapTarget::RulerTick, kInvalidItemID);
+        }
+    }
+
+    if (result.isSnapped()) {
+        qreal x = mapFrameToAxisX(result.frame);
+        qreal top = sceneRect().top();
+        qreal bottom = sceneRect().bottom();
+        // 对齐item边缘时参考线只连接两个item
+        if (result.target == QmSnapTarget::ItemEdge) {
+            qreal y = model()->itemY(item_id);
+            qreal target_y = model()->itemY(result.item_id);
+            top = qMin(y, target_y);
+            bottom = qMax(y + model()->itemHeight(item_id), target_y + model()->itemHeight(result.item_id));
+        }
+        result.guide = QLineF(x, top, x, bottom);
+    }
+    setSnapGuide(result.guide);
+    return result;
+}
+
+QLineF QmTimelineScene::snapGuide() const
+{
+    return d_->snap_guide;
+}
+
+void QmTimelineScene::beginSnap(std::vector<QmItemID> excluded)
+{
+    // 只记录被拖动的item，索引在第一次吸附时建立，单击而不拖动时不遍历模型
+    std::sort(excluded.begin(), excluded.end());
+    d_->snap_excluded = std::move(excluded);
+    d_->snap_index.clear();
+    d_->snap_index_built = false;
+    d_->snapping = true;
+}
+
+void QmTimelineScene::endSnap()
+{
+    d_->snap_index.clear();
+    d_->snap_excluded.clear();
+    d_->snap_index_built = false;
+    d_->snapping = false;
+    setSnapGuide({});
+}
+
+void QmTimelineScene::setSnapGuide(const QLineF& guide)
+{
+    if (guide == d_->snap_guide) {
+        return;
+    }
+    auto guide_rect = [](const QLineF& line) { return QRectF(line.p1(), line.p2()).normalized().adjusted(-1, -1, 1, 1); };
+    if (!d_->snap_guide.isNull()) {
+        invalidate(guide_rect(d_->snap_guide), QGraphicsScene::ForegroundLayer);
+    }
+    d_->snap_guide = guide;
+    if (!guide.isNull()) {
+        invalidate(guide_rect(guide), QGraphicsScene::ForegroundLayer);
+    }
+    emit snapGuideChanged(guide);
+}
+
+void QmTimelineScene::onMoveSelectionRequested(QmItemID item_id, qint64 new_start)
+{
+    auto* item = model()->item(item_id);
+    if (!item) {
+        return;
+    }
+    emit requestMoveItems(selectedItems(), new_start - item->start());
+}
+
 void QmTimelineScene::onItemCreated(QmItemID item_id)
 {
-    auto item_view = QmTimelineItemFactory::instance().createItemView(item_id, this);
-    connect(item_view.get(), &QmTimelineItemView::requestMove, this, &QmTimelineScene::requestMoveItem);
-    connect(item_view.get(), &QmTimelineItemView::moveFinished, this, &QmTimelineScene::itemMoveFinished);
+    if (isInLiveRange(item_id)) {
+        // 同一id的item被重新创建时，旧视图先回收
+        releaseItemView(item_id);
+        acquireItemView(item_id);
+    }
+    updateRowEdges(QmTimelineItemModel::itemRowId(item_id));
+}
+
+std::array<qint64, 2> QmTimelineScene::calcLiveRange() const
+{
+    qint64 minimum = model()->viewFrameMinimum();
+    qint64 maximum = model()->viewFrameMaximum();
+    qint64 margin = qMax<qint64>(1, (maximum - minimum) / 2);
+    return { minimum - margin, maximum + margin };
+}
+
+bool QmTimelineScene::isInLiveRange(QmItemID item_id) const
+{
+    const auto* index = model()->rowIndex(QmTimelineItemModel::itemRowId(item_id));
+    if (!index) {
+        return false;
+    }
+    qsizetype pos = model()->itemNumber(item_id) - 1;
+    if (pos < 0) {
+        return false;
+    }
+    auto [first, last] = liveSpan(*index, d_->live_range);
+    return pos >= first && pos < last;
+}
+
+bool QmTimelineScene::needsItemView(QmItemID item_id) const
+{
+    if (isInLiveRange(item_id)) {
+        return true;
+    }
+    auto it = d_->row_edges.find(QmTimelineItemModel::itemRowId(item_id));
+    return it != d_->row_edges.end() && (it->second[0] == item_id || it->second[1] == item_id);
+}
+
+void QmTimelineScene::updateRowEdges(int row_id)
+{
+    if (d_->live_range[0] > d_->live_range[1]) {
+        return;
+    }
+    // 行中item增删或移动后，范围两侧的item可能换了，旧的不再需要时回收
+    std::array<QmItemID, 2> old_edges { kInvalidItemID, kInvalidItemID };
+    if (auto it = d_->row_edges.find(row_id); it != d_->row_edges.end()) {
+        old_edges = it->second;
+        d_->row_edges.erase(it);
+    }
+    if (const auto* index = model()->rowIndex(row_id); index) {
+        auto [first, last] = liveSpan(*index, d_->live_range);
+        auto edges = spanEdges(*index, first, last);
+        d_->row_edges[row_id] = edges;
+        for (auto item_id : edges) {
+            if (item_id != kInvalidItemID && !d_->item_views.contains(item_id) && acquireItemView(item_id)) {
+                createItemConnViews(item_id);
+            }
+        }
+    }
+    for (auto item_id : old_edges) {
+        if (auto* item_view = itemView(item_id); item_view && !item_view->isSelected() && !needsItemView(item_id)) {
+            releaseItemView(item_id);
+        }
+    }
+}
+
+void QmTimelineScene::updateLiveViews()
+{
+    auto old_range = d_->live_range;
+    d_->live_range = calcLiveRange();
+    bool initial = old_range[0] > old_range[1];
+
+    // 新旧范围在当前行索引上各对应一段连续的位置，只处理两段的差集
+    std::vector<QmItemID> leaving;
+    std::vector<QmItemID> entering;
+    // 两侧额外保留的item按登记的id处理，不依赖它们在行索引中的位置
+    auto old_edges = std::move(d_->row_edges);
+    d_->row_edges.clear();
+    for (const auto& [_, edges] : old_edges) {
+        leaving.insert(leaving.end(), edges.begin(), edges.end());
+    }
+    for (int row_id : model()->rowIds()) {
+        const auto* index = model()->rowIndex(row_id);
+        if (!index) {
+            continue;
+        }
+        auto [new_first, new_last] = liveSpan(*index, d_->live_range);
+        auto edges = spanEdges(*index, new_first, new_last);
+        d_->row_edges[row_id] = edges;
+        entering.insert(entering.end(), edges.begin(), edges.end());
+        if (initial) {
+            for (qsizetype pos = new_first; pos < new_last; ++pos) {
+                entering.push_back(index->idAt(pos));
+            }
+            continue;
+        }
+        auto [old_first, old_last] = liveSpan(*index, old_range);
+        for (qsizetype pos = old_first; pos < qMin(old_last, new_first); ++pos) {
+            leaving.push_back(index->idAt(pos));
+        }
+        for (qsizetype pos = qMax(old_first, new_last); pos < old_last; ++pos) {
+            leaving.push_back(index->idAt(pos));
+        }
+        for (qsizetype pos = new_first; pos < qMin(new_last, old_first); ++pos) {
+            entering.push_back(index->idAt(pos));
+        }
+        for (qsizetype pos = qMax(new_first, old_last); pos < new_last; ++pos) {
+            entering.push_back(index->idAt(pos));
+        }
+    }
+
+    // 选中的视图即使离开范围也保留，避免丢失选中状态
+    for (auto item_id : leaving) {
+        if (auto* item_view = itemView(item_id); item_view && !item_view->isSelected() && !needsItemView(item_id)) {
+            releaseItemView(item_id);
+        }
+    }
+    std::erase(entering, kInvalidItemID);
+    for (auto item_id : entering) {
+        if (!d_->item_views.contains(item_id)) {
+            acquireItemView(item_id);
+        }
+    }
+    for (auto item_id : entering) {
+        createItemConnViews(item_id);
+    }
+}
+
+QmTimelineItemView* QmTimelineScene::acquireItemView(QmItemID item_id)
+{
+    std::unique_ptr<QmTimelineItemView> item_view;
+    auto& pool = d_->view_pool[QmTimelineItemModel::itemType(item_id)];
+    if (!pool.empty()) {
+        item_view = std::move(pool.back());
+        pool.pop_back();
+        addItem(item_view.get());
+        item_view->setShadowMode(shadowMode());
+        item_view->bindItem(item_id);
+    } else {
+        item_view = QmTimelineItemFactory::instance().createItemView(item_id, this);
+        if (!item_view) {
+            return nullptr;
+        }
+        // 信号中携带的是视图当前绑定的item_id，复用后无需重新连接
+        connect(item_view.get(), &QmTimelineItemView::requestMove, this, &QmTimelineScene::requestMoveItem);
+        connect(item_view.get(), &QmTimelineItemView::moveFinished, this, &QmTimelineScene::itemMoveFinished);
+        connect(item_view.get(), &QmTimelineItemView::requestMoveSelection, this, &QmTimelineScene::onMoveSelectionRequested);
+    }
+    auto* item_view_ptr = item_view.get();
     d_->item_views[item_id] = std::move(item_view);
+    return item_view_ptr;
+}
+
+void QmTimelineScene::releaseItemView(QmItemID item_id)
+{
+    auto item_it = d_->item_views.find(item_id);
+    if (item_it == d_->item_views.end()) {
+        return;
+    }
+    // 连接线依赖两端的视图
+    removeItemConnViews(item_id);
+
+    auto item_view = std::move(item_it->second);
+    d_->item_views.erase(item_it);
+    auto& pool = d_->view_pool[QmTimelineItemModel::itemType(item_id)];
+    if (pool.size() >= kMaxPooledViews) {
+        return;
+    }
+    item_view->setSelected(false);
+    removeItem(item_view.get());
+    pool.push_back(std::move(item_view));
+}
+
+void QmTimelineScene::createItemConnViews(QmItemID item_id)
+{
+    for (const auto& conn_id : { model()->previousConnection(item_id), model()->nextConnection(item_id) }) {
+        if (conn_id.isValid() && !d_->item_conn_views.contains(conn_id)) {
+            onItemConnCreated(conn_id);
+        }
+    }
+}
+
+void QmTimelineScene::removeItemConnViews(QmItemID item_id)
+{
+    for (const auto& conn_id : { model()->previousConnection(item_id), model()->nextConnection(item_id) }) {
+        if (conn_id.isValid()) {
+            onItemConnRemoved(conn_id);
+        }
+    }
 }
 
 void QmTimelineScene::onItemChanged(QmItemID item_id, int role)
 {
+    if (role & (QmTimelineItem::StartRole | QmTimelineItem::DurationRole)) {
+        // 范围的增量更新只比较位置，item移入移出范围时在这里单独处理，所在行两侧保留的item也可能随之改变
+        updateRowEdges(QmTimelineItemModel::itemRowId(item_id));
+        bool needed = needsItemView(item_id);
+        auto* item_view = itemView(item_id);
+        if (!item_view && needed) {
+            if (acquireItemView(item_id)) {
+                createItemConnViews(item_id);
+            }
+            return;
+        }
+        if (item_view && !needed && !item_view->isSelected()) {
+            releaseItemView(item_id);
+            return;
+        }
+    }
     auto* item_view = itemView(item_id);
     if (!item_view) {
         return;
@@ -193,11 +710,8 @@ void QmTimelineScene::onItemChanged(QmItemID item_id, int role)
 
 void QmTimelineScene::onItemRemoved(QmItemID item_id)
 {
-    auto item_it = d_->item_views.find(item_id);
-    if (item_it == d_->item_views.end()) {
-        return;
-    }
-    d_->item_views.erase(item_it);
+    releaseItemView(item_id);
+    updateRowEdges(QmTimelineItemModel::itemRowId(item_id));
 }
 
 void QmTimelineScene::onUpdateItemYRequested(QmItemID item_id)
@@ -209,11 +723,83 @@ void QmTimelineScene::onUpdateItemYRequested(QmItemID item_id)
     item_view->updateY();
 }
 
-void QmTimelineScene::onItemConnCreated(const QmItemConnID& conn_id)
+void QmTimelineScene::onItemsRippled(int row_id)
+{
+    // 范围本身没有变化，但行中落在范围内的item变了：先回收移出范围的视图，再为移入的item创建视图
+    auto is_affected = [row_id](QmItemID item_id) { return row_id < 0 || QmTimelineItemModel::itemRowId(item_id) == row_id; };
+    std::vector<int> row_ids = row_id < 0 ? model()->rowIds() : std::vector<int> { row_id };
+    for (int affected_row_id : row_ids) {
+        updateRowEdges(affected_row_id);
+    }
+    std::vector<QmItemID> leaving;
+    for (const auto& [item_id, item_view] : d_->item_views) {
+        if (is_affected(item_id) && !needsItemView(item_id) && !item_view->isSelected()) {
+            leaving.push_back(item_id);
+        }
+    }
+    for (auto item_id : leaving) {
+        releaseItemView(item_id);
+    }
+
+    std::vector<QmItemID> entering;
+    for (int affected_row_id : row_ids) {
+        const auto* index = model()->rowIndex(affected_row_id);
+        if (!index) {
+            continue;
+        }
+        auto [first, last] = liveSpan(*index, d_->live_range);
+        for (qsizetype pos = first; pos < last; ++pos) {
+            if (QmItemID item_id = index->idAt(pos); !d_->item_views.contains(item_id)) {
+                acquireItemView(item_id);
+                entering.push_back(item_id);
+            }
+        }
+    }
+    for (auto item_id : entering) {
+        createItemConnViews(item_id);
+    }
+
+    // 只有保留的视图需要重新读取start
+    std::vector<QmItemID> live_ids;
+    live_ids.reserve(d_->item_views.size());
+    for (const auto& [item_id, _] : d_->item_views) {
+        if (is_affected(item_id)) {
+            live_ids.push_back(item_id);
+        }
+    }
+    for (auto item_id : live_ids) {
+        fitItemInAxis(item_id);
+    }
+}
+
+void QmTimelineScene::onItemsMoved(const std::vector<QmItemID>& item_ids)
 {
+    // 未选中的item没有移动，只有被移动的item可能进出范围，按start变化逐个处理
+    for (auto item_id : item_ids) {
+        onItemChanged(item_id, QmTimelineItem::StartRole | QmTimelineItem::ToolTipRole);
+    }
+}
 
+void QmTimelineScene::onRowsYChanged(int first_row)
+{
+    // 只有保留的视图需要移动，对象池中的视图复用时会重新计算y
+    for (auto& [item_id, item_view] : d_->item_views) {
+        if (QmTimelineItemModel::itemRowId(item_id) >= first_row) {
+            item_view->updateY();
+        }
+    }
+    for (auto& [conn_id, conn_view] : d_->item_conn_views) {
+        if (QmTimelineItemModel::itemRowId(conn_id.from) >= first_row) {
+            conn_view->updateY();
+        }
+    }
+}
+
+void QmTimelineScene::onItemConnCreated(const QmItemConnID& conn_id)
+{
+    // 两端都有视图时才创建连接线
     auto* item_view = itemView(conn_id.from);
-    if (!item_view) {
+    if (!item_view || !itemView(conn_id.to)) {
         return;
     }
     auto conn_item = new QmTimelineItemConnView(conn_id, *this);
@@ -229,6 +815,38 @@ void QmTimelineScene::onItemConnRemoved(const QmItemConnID& conn_id)
     }
 }
 
+void QmTimelineScene::onItemsBatchChanged(const QmItemBatchChange& change)
+{
+    // 连接线依赖起点item的视图，先删连接线再删item，先建item再建连接线
+    for (const auto& conn_id : change.conn_removed) {
+        onItemConnRemoved(conn_id);
+    }
+    for (auto item_id : change.removed) {
+        onItemRemoved(item_id);
+    }
+
+    // 大量添加时暂停场景索引，结束后整体重建一次
+    auto index_method = itemIndexMethod();
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+    for (auto item_id : change.created) {
+        if (isInLiveRange(item_id)) {
+            releaseItemView(item_id);
+            acquireItemView(item_id);
+        }
+    }
+    for (int row_id : change.rows) {
+        updateRowEdges(row_id);
+    }
+    for (const auto& conn_id : change.conn_created) {
+        onItemConnCreated(conn_id);
+    }
+    setItemIndexMethod(index_method);
+
+    for (auto item_id : change.created) {
+        onRebuildItemViewCacheRequested(item_id);
+    }
+}
+
 void QmTimelineScene::onItemOperateFinished(QmItemID item_id, int role, const QVariant& param)
 {
     auto* item_view = itemView(item_id);
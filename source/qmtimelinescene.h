@@ -1,8 +1,10 @@
 #pragma once
 
 #include "qmtimeline_global.h"
+#include "qmtimelinesnapindex.h"
 #include "qmtimelinetype.h"
 #include <QGraphicsScene>
+#include <array>
 
 class QUndoCommand;
 class QUndoStack;
@@ -36,7 +38,24 @@ public:
 
     QList<QmItemID> selectedItems() const;
 
+    // 默认使用共享的阴影图，item很多时可以关闭阴影
+    void setShadowMode(QmShadowMode mode);
+    QmShadowMode shadowMode() const;
+
+    // 拖动item时吸附的目标，默认不吸附
+    void setSnapTargets(QmSnapTargets targets);
+    QmSnapTargets snapTargets() const;
+    // 吸附距离，单位为像素，按axisFramePixels()换算成帧
+    void setSnapTolerance(qreal pixels);
+    qreal snapTolerance() const;
+    // item被拖动到start时吸附后的位置，同时更新吸附参考线。
+    // 拖动开始时建立其他item的边缘索引，每次调用只做O(log n)的查询
+    QmSnapResult snapItemStart(QmItemID item_id, qint64 start);
+    QLineF snapGuide() const;
+
     void fitInAxis();
+    // 在下一次事件循环中执行fitInAxis，多次调用只执行一次
+    void scheduleFitInAxis();
 
     void refreshCache();
     void undo();
@@ -50,9 +69,18 @@ signals:
     void requestItemContextMenu(QmItemID item_id);
     void requestMoveItem(QmItemID item_id, qint64 start);
     void itemMoveFinished(QmItemID item_id, qint64 old_start);
+    // 拖动多选时发出，item_ids整体平移delta帧，通常交给QmTimelineItemModel::moveItems统一限制并应用
+    void requestMoveItems(const QList<QmItemID>& item_ids, qint64 delta);
+    // 多选拖动结束，{item_id: 拖动之前的start}，只包含位置改变的item
+    void itemsMoveFinished(const std::map<QmItemID, qint64>& old_starts);
+    // 吸附参考线改变，guide为空时表示清除
+    void snapGuideChanged(const QLineF& guide);
 
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent* event) override;
+    void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
+    void drawForeground(QPainter* painter, const QRectF& rect) override;
 
 private:
     void onItemCreated(QmItemID item_id);
@@ -60,14 +88,39 @@ private:
     void onItemRemoved(QmItemID item_id);
     void onItemAboutToBeRemoved(QmItemID item_id);
     void onUpdateItemYRequested(QmItemID item_id);
+    void onRowsYChanged(int first_row);
+    void onItemsRippled(int row_id);
+    void onItemsMoved(const std::vector<QmItemID>& item_ids);
 
     void onItemConnCreated(const QmItemConnID& conn_id);
     void onItemConnRemoved(const QmItemConnID& conn_id);
+    void onItemsBatchChanged(const QmItemBatchChange& change);
+
+    // 只为可视范围(加上余量)内的item保留视图对象，离开范围的视图回收到对象池
+    void updateLiveViews();
+    std::array<qint64, 2> calcLiveRange() const;
+    // item是否与当前已应用的范围相交
+    bool isInLiveRange(QmItemID item_id) const;
+    // 与范围相交，或是所在行范围两侧额外保留的item
+    bool needsItemView(QmItemID item_id) const;
+    // 重新确定行中范围两侧保留的item，回收不再需要的视图
+    void updateRowEdges(int row_id);
+    QmTimelineItemView* acquireItemView(QmItemID item_id);
+    void releaseItemView(QmItemID item_id);
+    void createItemConnViews(QmItemID item_id);
+    void removeItemConnViews(QmItemID item_id);
+    void fitItemInAxis(QmItemID item_id);
 
     void onRefreshItemViewCacheRequested(QmItemID item_id);
     void onRebuildItemViewCacheRequested(QmItemID item_id);
 
     void onItemOperateFinished(QmItemID item_id, int role, const QVariant& param);
+    void onMoveSelectionRequested(QmItemID item_id, qint64 new_start);
+
+    // excluded为被拖动的item，不作为吸附目标
+    void beginSnap(std::vector<QmItemID> excluded);
+    void endSnap();
+    void setSnapGuide(const QLineF& guide);
 
 private:
     QmTimelineScenePrivate* d_ { nullptr };
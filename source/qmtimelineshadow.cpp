@@ -0,0 +1,129 @@
+#include "qmtimelineshadow.h"
+#include <QImage>
+#include <QPainter>
+#include <QPixmapCache>
+#include <qdrawutil.h>
+#include <vector>
+
+namespace qmtl {
+
+namespace {
+// 对alpha通道做一次水平和垂直的盒式模糊
+void boxBlur(std::vector<int>& alpha, int width, int height, int radius)
+{
+    std::vector<int> buffer(alpha.size());
+    int window = 2 * radius + 1;
+    for (int y = 0; y < height; ++y) {
+        const int* src = alpha.data() + y * width;
+        int sum = 0;
+        for (int x = -radius; x <= radius; ++x) {
+            sum += src[qBound(0, x, width - 1)];
+        }
+        for (int x = 0; x < width; ++x) {
+            buffer[y * width + x] = sum / window;
+            sum += src[qMin(x + radius + 1, width - 1)] - src[qMax(x - radius, 0)];
+        }
+    }
+    for (int x = 0; x < width; ++x) {
+        int sum = 0;
+        for (int y = -radius; y <= radius; ++y) {
+            sum += buffer[qBound(0, y, height - 1) * width + x];
+        }
+        for (int y = 0; y < height; ++y) {
+            alpha[y * width + x] = sum / window;
+            sum += buffer[qMin(y + radius + 1, height - 1) * width + x] - buffer[qMax(y - radius, 0) * width + x];
+        }
+    }
+}
+
+QPixmap renderShadowPixmap(int blur_radius, const QColor& color)
+{
+    // 阴影向外扩散blur_radius，向内衰减blur_radius，边框宽度取两者之和
+    int border = 2 * blur_radius;
+    int size = 2 * border + 1;
+    std::vector<int> alpha(size * size, 0);
+    for (int y = blur_radius; y < size - blur_radius; ++y) {
+        for (int x = blur_radius; x < size - blur_radius; ++x) {
+            alpha[y * size + x] = 255;
+        }
+    }
+    // 三次盒式模糊近似高斯模糊
+    int pass_radius = qMax(1, blur_radius / 3);
+    for (int i = 0; i < 3; ++i) {
+        boxBlur(alpha, size, size, pass_radius);
+    }
+
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < size; ++y) {
+        auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size; ++x) {
+            int a = alpha[y * size + x] * color.alpha() / 255;
+            line[x] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), a));
+        }
+    }
+    return QPixmap::fromImage(image);
+}
+} // namespace
+
+QmTimelineShadowItem::QmTimelineShadowItem(QGraphicsItem* parent)
+    : QGraphicsItem(parent)
+{
+    setFlag(QGraphicsItem::ItemStacksBehindParent, true);
+    setAcceptedMouseButtons(Qt::NoButton);
+    setAcceptHoverEvents(false);
+}
+
+int QmTimelineShadowItem::type() const
+{
+    return Type;
+}
+
+void QmTimelineShadowItem::setRect(const QRectF& rect)
+{
+    if (rect == rect_) {
+        return;
+    }
+    prepareGeometryChange();
+    rect_ = rect;
+}
+
+QRectF QmTimelineShadowItem::rect() const
+{
+    return rect_;
+}
+
+QRectF QmTimelineShadowItem::boundingRect() const
+{
+    if (rect_.isEmpty()) {
+        return {};
+    }
+    return rect_.adjusted(-kBlurRadius, -kBlurRadius, kBlurRadius, kBlurRadius);
+}
+
+void QmTimelineShadowItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    if (rect_.isEmpty()) {
+        return;
+    }
+    QPixmap pixmap = shadowPixmap(kBlurRadius, Qt::black);
+    int border = 2 * kBlurRadius;
+    QRect target = boundingRect().toAlignedRect();
+    // item比阴影边框还小时按比例缩小边框，避免九宫格的四角互相重叠
+    int target_border_x = qMin(border, target.width() / 2);
+    int target_border_y = qMin(border, target.height() / 2);
+    qDrawBorderPixmap(painter, target, QMargins(target_border_x, target_border_y, target_border_x, target_border_y), pixmap, pixmap.rect(),
+        QMargins(border, border, border, border));
+}
+
+QPixmap QmTimelineShadowItem::shadowPixmap(int blur_radius, const QColor& color)
+{
+    QString key = QStringLiteral("qmtl_shadow_%1_%2").arg(blur_radius).arg(color.rgba(), 8, 16, QLatin1Char('0'));
+    QPixmap pixmap;
+    if (!QPixmapCache::find(key, &pixmap)) {
+        pixmap = renderShadowPixmap(blur_radius, color);
+        QPixmapCache::insert(key, pixmap);
+    }
+    return pixmap;
+}
+
+} // namespace qmtl
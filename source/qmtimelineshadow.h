@@ -0,0 +1,36 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include <QGraphicsItem>
+#include <QPixmap>
+
+namespace qmtl {
+
+// 叠放在item视图后面的阴影，使用共享的九宫格阴影图绘制，代替每个视图单独的QGraphicsDropShadowEffect
+class QMTIMELINE_LIB_EXPORT QmTimelineShadowItem : public QGraphicsItem {
+public:
+    static constexpr int kBlurRadius = 20;
+
+    explicit QmTimelineShadowItem(QGraphicsItem* parent);
+
+    enum {
+        Type = UserType + 2,
+    };
+    int type() const override;
+
+    // 阴影投射的矩形，使用父视图坐标
+    void setRect(const QRectF& rect);
+    QRectF rect() const;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+
+    // 相同(模糊半径, 颜色)的阴影图只渲染一次，保存在QPixmapCache中
+    // 图片四周各有2*blur_radius的边框，中间一个像素用于拉伸
+    static QPixmap shadowPixmap(int blur_radius, const QColor& color);
+
+private:
+    QRectF rect_;
+};
+
+} // namespace qmtl
@@ -0,0 +1,73 @@
+#include "qmtimelinesnapindex.h"
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinerowindex.h"
+#include <algorithm>
+
+namespace qmtl {
+
+void QmTimelineSnapIndex::build(const QmTimelineItemModel& model, std::span<const QmItemID> excluded)
+{
+    edges_.clear();
+    auto row_ids = model.rowIds();
+    qsizetype count = 0;
+    for (int row_id : row_ids) {
+        count += model.rowIndex(row_id)->size();
+    }
+    edges_.reserve(count * 2);
+
+    // 直接读取行索引的start/end数组，不创建item
+    for (int row_id : row_ids) {
+        auto range = model.rowIndex(row_id)->all();
+        auto ids = range.ids();
+        auto starts = range.starts();
+        auto ends = range.ends();
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            if (std::binary_search(excluded.begin(), excluded.end(), ids[i])) {
+                continue;
+            }
+            edges_.push_back({ starts[i], ids[i] });
+            edges_.push_back({ ends[i], ids[i] });
+        }
+    }
+    std::sort(edges_.begin(), edges_.end(), [](const Edge& lhs, const Edge& rhs) {
+        return lhs.frame < rhs.frame || (lhs.frame == rhs.frame && lhs.item_id < rhs.item_id);
+    });
+}
+
+void QmTimelineSnapIndex::clear()
+{
+    edges_.clear();
+}
+
+bool QmTimelineSnapIndex::isEmpty() const
+{
+    return edges_.empty();
+}
+
+qsizetype QmTimelineSnapIndex::size() const
+{
+    return static_cast<qsizetype>(edges_.size());
+}
+
+const QmTimelineSnapIndex::Edge* QmTimelineSnapIndex::nearest(qint64 frame, qint64 tolerance) const
+{
+    auto less = [](const Edge& edge, qint64 value) { return edge.frame < value; };
+    // 最近的边缘只可能是第一个frame >= frame的边缘或它的前一个
+    auto it = std::lower_bound(edges_.begin(), edges_.end(), frame, less);
+    const Edge* result = nullptr;
+    if (it != edges_.begin()) {
+        // 相同帧的多个边缘取item_id最小的一个
+        auto prev = std::lower_bound(edges_.begin(), it, std::prev(it)->frame, less);
+        if (frame - prev->frame <= tolerance) {
+            result = &*prev;
+        }
+    }
+    if (it != edges_.end() && it->frame - frame <= tolerance) {
+        if (!result || it->frame - frame < frame - result->frame) {
+            result = &*it;
+        }
+    }
+    return result;
+}
+
+} // namespace qmtl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "qmtimelinetype.h"
+#include <QFlags>
+#include <QLineF>
+#include <span>
+#include <vector>
+
+namespace qmtl {
+
+class QmTimelineItemModel;
+
+// 拖动item时可以吸附的目标
+enum class QmSnapTarget {
+    None = 0x00,
+    // 其他item的开始和结束
+    ItemEdge = 0x01,
+    Playhead = 0x02,
+    RulerTick = 0x04,
+};
+Q_DECLARE_FLAGS(QmSnapTargets, QmSnapTarget)
+Q_DECLARE_OPERATORS_FOR_FLAGS(QmSnapTargets)
+
+struct QmSnapResult {
+    // 吸附后item的start，没有吸附时为传入的start
+    qint64 start { 0 };
+    QmSnapTarget target { QmSnapTarget::None };
+    // 吸附到的帧
+    qint64 frame { 0 };
+    // target为ItemEdge时对齐的item
+    QmItemID item_id { kInvalidItemID };
+    // 场景坐标中的吸附参考线，没有吸附时为空
+    QLineF guide;
+
+    bool isSnapped() const
+    {
+        return target != QmSnapTarget::None;
+    }
+};
+
+// 所有行item边缘的有序索引。
+// 拖动中第一次吸附时建立一次，O(n log n)，拖动中每次查询二分查找，O(log n)。
+// 被拖动的item在建立时排除，拖动期间其他item不变，索引无需更新。
+class QMTIMELINE_LIB_EXPORT QmTimelineSnapIndex {
+public:
+    struct Edge {
+        qint64 frame { 0 };
+        QmItemID item_id { kInvalidItemID };
+    };
+
+    // excluded按升序传入
+    void build(const QmTimelineItemModel& model, std::span<const QmItemID> excluded);
+    void clear();
+    bool isEmpty() const;
+    qsizetype size() const;
+
+    // 与frame距离不超过tolerance帧的最近边缘，距离相同时取较小的帧，没有时返回nullptr
+    const Edge* nearest(qint64 frame, qint64 tolerance) const;
+
+private:
+    std::vector<Edge> edges_;
+};
+
+} // namespace qmtl
@@ -1,14 +1,23 @@
 #include "qmtimelinetransaction.h"
 #include "qmtimelineitem.h"
 #include "qmtimelineitemmodel.h"
+#include "qmtimelinelog.h"
 #include <QCoreApplication>
+#include <algorithm>
+#include <atomic>
 
 namespace qmtl {
+
+namespace {
+constexpr int kDefaultMergeWindow = 500;
+std::atomic<int> merge_window { kDefaultMergeWindow };
+} // namespace
+
 QmTimelineItemCreateCommand::QmTimelineItemCreateCommand(QmTimelineItemModel* model, QmItemID item_id, QUndoCommand* parent)
     : QUndoCommand(parent)
     , model_(model)
     , item_id_(item_id)
-    , item_data_(model->saveItem(item_id))
+    , item_data_(QmTimelineUndoPayload::fromJson(model->saveItem(item_id)))
 {
     setText(QCoreApplication::translate("QmTimelineItemCreateCommand", "Create Item"));
 }
@@ -20,21 +29,31 @@ void QmTimelineItemCreateCommand::undo()
 
 void QmTimelineItemCreateCommand::redo()
 {
-    model_->loadItem(item_data_);
+    auto j = item_data_.json();
+    if (j.is_null()) {
+        QMTL_LOG_ERROR("Failed to redo creating item {}, undo data is lost.", item_id_);
+        return;
+    }
+    model_->loadItem(j);
 }
 
 QmTimelineItemDeleteCommand::QmTimelineItemDeleteCommand(QmTimelineItemModel* model, QmItemID item_id, QUndoCommand* parent)
     : QUndoCommand(parent)
     , model_(model)
     , item_id_(item_id)
-    , item_data_(model_->saveItem(item_id_))
+    , item_data_(QmTimelineUndoPayload::fromJson(model_->saveItem(item_id_)))
 {
     setText(QCoreApplication::translate("QmTimelineItemDeleteCommand", "Delete Item"));
 }
 
 void QmTimelineItemDeleteCommand::undo()
 {
-    model_->loadItem(item_data_);
+    auto j = item_data_.json();
+    if (j.is_null()) {
+        QMTL_LOG_ERROR("Failed to undo deleting item {}, undo data is lost.", item_id_);
+        return;
+    }
+    model_->loadItem(j);
 }
 
 void QmTimelineItemDeleteCommand::redo()
@@ -42,8 +61,139 @@ void QmTimelineItemDeleteCommand::redo()
     model_->removeItem(item_id_);
 }
 
-QmTimelineItemMoveCommand::QmTimelineItemMoveCommand(QmTimelineItemModel* model, QmItemID item_id, qint64 old_start, QUndoCommand* parent)
+QmTimelineItemsCreateCommand::QmTimelineItemsCreateCommand(QmTimelineItemModel* model, const std::vector<QmItemID>& item_ids, QUndoCommand* parent)
+    : QUndoCommand(parent)
+    , model_(model)
+    , item_ids_(item_ids)
+    , items_data_(model->saveItems(item_ids))
+{
+    setText(QCoreApplication::translate("QmTimelineItemsCreateCommand", "Create %n Item(s)", nullptr, static_cast<int>(item_ids_.size())));
+}
+
+void QmTimelineItemsCreateCommand::undo()
+{
+    model_->removeItems(item_ids_);
+}
+
+void QmTimelineItemsCreateCommand::redo()
+{
+    // 第一次压入撤销栈时item已经存在，restoreItems会跳过
+    QByteArray data = items_data_.data();
+    if (data.isEmpty()) {
+        QMTL_LOG_ERROR("Failed to redo creating {} items, undo data is lost.", item_ids_.size());
+        return;
+    }
+    model_->restoreItems(data);
+}
+
+QmTimelineItemsDeleteCommand::QmTimelineItemsDeleteCommand(QmTimelineItemModel* model, const std::vector<QmItemID>& item_ids, QUndoCommand* parent)
+    : QUndoCommand(parent)
+    , model_(model)
+    , item_ids_(item_ids)
+    , items_data_(model->saveItems(item_ids))
+{
+    setText(QCoreApplication::translate("QmTimelineItemsDeleteCommand", "Delete %n Item(s)", nullptr, static_cast<int>(item_ids_.size())));
+}
+
+void QmTimelineItemsDeleteCommand::undo()
+{
+    QByteArray data = items_data_.data();
+    if (data.isEmpty()) {
+        QMTL_LOG_ERROR("Failed to undo deleting {} items, undo data is lost.", item_ids_.size());
+        return;
+    }
+    model_->restoreItems(data);
+}
+
+void QmTimelineItemsDeleteCommand::redo()
+{
+    model_->removeItems(item_ids_);
+}
+
+QmTimelineItemsMoveCommand::QmTimelineItemsMoveCommand(QmTimelineItemModel* model, const std::map<QmItemID, qint64>& old_starts, QUndoCommand* parent)
+    : QUndoCommand(parent)
+    , model_(model)
+{
+    moves_.reserve(old_starts.size());
+    for (const auto& [item_id, old_start] : old_starts) {
+        if (auto* item = model_->item(item_id); item && item->start() != old_start) {
+            moves_.push_back({ item_id, old_start, item->start() });
+        }
+    }
+
+    setText(QCoreApplication::translate("QmTimelineItemsMoveCommand", "Move %n Item(s)", nullptr, static_cast<int>(moves_.size())));
+}
+
+void QmTimelineItemsMoveCommand::undo()
+{
+    moveTo(true);
+}
+
+void QmTimelineItemsMoveCommand::redo()
+{
+    moveTo(false);
+}
+
+void QmTimelineItemsMoveCommand::moveTo(bool to_old_start)
+{
+    // modifyItemStart会把item限制在相邻item之间，同一行中向右移动的item从右往左处理、向左移动的从左往右处理，
+    // 整组平移时每个item移动时前方的位置都已经空出
+    struct Step {
+        QmItemID item_id;
+        qint64 from;
+        qint64 to;
+    };
+    std::vector<Step> steps;
+    steps.reserve(moves_.size());
+    for (const auto& move : moves_) {
+        qint64 target = to_old_start ? move.old_start : move.new_start;
+        if (auto* item = model_->item(move.item_id); item && item->start() != target) {
+            steps.push_back({ move.item_id, item->start(), target });
+        }
+    }
+    std::sort(steps.begin(), steps.end(), [](const Step& lhs, const Step& rhs) {
+        bool lhs_right = lhs.to > lhs.from;
+        bool rhs_right = rhs.to > rhs.from;
+        if (lhs_right != rhs_right) {
+            return !lhs_right;
+        }
+        return lhs_right ? lhs.from > rhs.from : lhs.from < rhs.from;
+    });
+
+    QmTimelineBatchScope batch(model_);
+    for (const auto& step : steps) {
+        model_->modifyItemStart(step.item_id, step.to);
+    }
+}
+
+QmTimelineMergeableCommand::QmTimelineMergeableCommand(QUndoCommand* parent)
     : QUndoCommand(parent)
+    , timestamp_(std::chrono::steady_clock::now())
+{
+}
+
+void QmTimelineMergeableCommand::setMergeWindow(int msec)
+{
+    merge_window = qMax(0, msec);
+}
+
+int QmTimelineMergeableCommand::mergeWindow()
+{
+    return merge_window;
+}
+
+bool QmTimelineMergeableCommand::isInMergeWindow(const QmTimelineMergeableCommand* other) const
+{
+    return other->timestamp_ - timestamp_ <= std::chrono::milliseconds(merge_window.load());
+}
+
+void QmTimelineMergeableCommand::touch(const QmTimelineMergeableCommand* other)
+{
+    timestamp_ = other->timestamp_;
+}
+
+QmTimelineItemMoveCommand::QmTimelineItemMoveCommand(QmTimelineItemModel* model, QmItemID item_id, qint64 old_start, QUndoCommand* parent)
+    : QmTimelineMergeableCommand(parent)
     , model_(model)
     , item_id_(item_id)
     , old_start_(old_start)
@@ -71,4 +221,71 @@ void QmTimelineItemMoveCommand::redo()
     }
 }
 
+int QmTimelineItemMoveCommand::id() const
+{
+    return MoveCommandId;
+}
+
+bool QmTimelineItemMoveCommand::mergeWith(const QUndoCommand* other)
+{
+    // id相同时QUndoStack保证other是同一类型
+    auto* command = static_cast<const QmTimelineItemMoveCommand*>(other);
+    if (command->model_ != model_ || command->item_id_ != item_id_ || !isInMergeWindow(command)) {
+        return false;
+    }
+    new_start_ = command->new_start_;
+    touch(command);
+    // 移回原处后整条记录不再需要
+    setObsolete(new_start_ == old_start_);
+    return true;
+}
+
+QmTimelineItemPropertyCommand::QmTimelineItemPropertyCommand(
+    QmTimelineItemModel* model, QmItemID item_id, int role, const QVariant& old_value, QUndoCommand* parent)
+    : QmTimelineMergeableCommand(parent)
+    , model_(model)
+    , item_id_(item_id)
+    , role_(role)
+    , old_value_(old_value)
+{
+    if (auto* item = model_->item(item_id_); item) {
+        new_value_ = item->property(role_).value_or(QVariant());
+    }
+
+    setText(QCoreApplication::translate("QmTimelineItemPropertyCommand", "Modify Item"));
+}
+
+void QmTimelineItemPropertyCommand::undo()
+{
+    auto* item = model_->item(item_id_);
+    if (item && item->property(role_) != old_value_) {
+        item->setProperty(role_, old_value_);
+    }
+}
+
+void QmTimelineItemPropertyCommand::redo()
+{
+    auto* item = model_->item(item_id_);
+    if (item && item->property(role_) != new_value_) {
+        item->setProperty(role_, new_value_);
+    }
+}
+
+int QmTimelineItemPropertyCommand::id() const
+{
+    return PropertyCommandId;
+}
+
+bool QmTimelineItemPropertyCommand::mergeWith(const QUndoCommand* other)
+{
+    auto* command = static_cast<const QmTimelineItemPropertyCommand*>(other);
+    if (command->model_ != model_ || command->item_id_ != item_id_ || command->role_ != role_ || !isInMergeWindow(command)) {
+        return false;
+    }
+    new_value_ = command->new_value_;
+    touch(command);
+    setObsolete(new_value_ == old_value_);
+    return true;
+}
+
 } // namespace qmtl
\ No newline at end of file
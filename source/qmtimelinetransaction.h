@@ -1,14 +1,18 @@
 #pragma once
 
 #include "nlohmann/json.hpp"
+#include "qmtimeline_global.h"
 #include "qmtimelinetype.h"
+#include "qmtimelineundostore.h"
 #include <QUndoCommand>
+#include <QVariant>
+#include <chrono>
 
 namespace qmtl {
 
 class QmTimelineItemModel;
 
-class QmTimelineItemCreateCommand : public QUndoCommand {
+class QMTIMELINE_LIB_EXPORT QmTimelineItemCreateCommand : public QUndoCommand {
 public:
     explicit QmTimelineItemCreateCommand(QmTimelineItemModel* model, QmItemID item_id, QUndoCommand* parent = nullptr);
 
@@ -18,10 +22,10 @@ public:
 private:
     QmTimelineItemModel* model_ { nullptr };
     QmItemID item_id_ { kInvalidItemID };
-    nlohmann::json item_data_;
+    QmTimelineUndoPayload item_data_;
 };
 
-class QmTimelineItemDeleteCommand : public QUndoCommand {
+class QMTIMELINE_LIB_EXPORT QmTimelineItemDeleteCommand : public QUndoCommand {
 public:
     explicit QmTimelineItemDeleteCommand(QmTimelineItemModel* model, QmItemID item_id, QUndoCommand* parent = nullptr);
 
@@ -31,15 +35,93 @@ public:
 private:
     QmTimelineItemModel* model_ { nullptr };
     QmItemID item_id_ { kInvalidItemID };
-    nlohmann::json item_data_;
+    QmTimelineUndoPayload item_data_;
 };
 
-class QmTimelineItemMoveCommand : public QUndoCommand {
+// 多个item的创建(例如粘贴)，在item创建之后创建。所有item的数据保存在一块缓冲区中，撤销/重做都是一次批量编辑
+class QMTIMELINE_LIB_EXPORT QmTimelineItemsCreateCommand : public QUndoCommand {
+public:
+    explicit QmTimelineItemsCreateCommand(QmTimelineItemModel* model, const std::vector<QmItemID>& item_ids, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    QmTimelineItemModel* model_ { nullptr };
+    std::vector<QmItemID> item_ids_;
+    QmTimelineUndoPayload items_data_;
+};
+
+// 多个item的删除，在item删除之前创建
+class QMTIMELINE_LIB_EXPORT QmTimelineItemsDeleteCommand : public QUndoCommand {
+public:
+    explicit QmTimelineItemsDeleteCommand(QmTimelineItemModel* model, const std::vector<QmItemID>& item_ids, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    QmTimelineItemModel* model_ { nullptr };
+    std::vector<QmItemID> item_ids_;
+    QmTimelineUndoPayload items_data_;
+};
+
+// 多个item的移动，在item移动之后创建
+class QMTIMELINE_LIB_EXPORT QmTimelineItemsMoveCommand : public QUndoCommand {
+public:
+    // old_starts: {item_id: 移动之前的start}
+    explicit QmTimelineItemsMoveCommand(
+        QmTimelineItemModel* model, const std::map<QmItemID, qint64>& old_starts, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    void moveTo(bool to_old_start);
+
+private:
+    struct ItemMove {
+        QmItemID item_id { kInvalidItemID };
+        qint64 old_start { 0 };
+        qint64 new_start { 0 };
+    };
+
+    QmTimelineItemModel* model_ { nullptr };
+    std::vector<ItemMove> moves_;
+};
+
+// 可合并的命令。对同一目标的连续修改，与上一次修改的间隔不超过合并窗口时合并为一条撤销记录，
+// 合并后只保留最早的旧值和最新的新值
+class QMTIMELINE_LIB_EXPORT QmTimelineMergeableCommand : public QUndoCommand {
+public:
+    enum CommandId : int {
+        MoveCommandId = 1,
+        PropertyCommandId = 2,
+    };
+
+    explicit QmTimelineMergeableCommand(QUndoCommand* parent = nullptr);
+
+    // 所有可合并命令共用的合并窗口，为0时不合并
+    static void setMergeWindow(int msec);
+    static int mergeWindow();
+
+protected:
+    bool isInMergeWindow(const QmTimelineMergeableCommand* other) const;
+    // 合并成功后调用，合并窗口从被合并命令的创建时刻重新计算
+    void touch(const QmTimelineMergeableCommand* other);
+
+private:
+    std::chrono::steady_clock::time_point timestamp_;
+};
+
+class QMTIMELINE_LIB_EXPORT QmTimelineItemMoveCommand : public QmTimelineMergeableCommand {
 public:
     explicit QmTimelineItemMoveCommand(QmTimelineItemModel* model, QmItemID item_id, qint64 old_start, QUndoCommand* parent = nullptr);
 
     void undo() override;
     void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand* other) override;
 
 private:
     QmTimelineItemModel* model_ { nullptr };
@@ -48,4 +130,23 @@ private:
     qint64 new_start_ { -1 };
 };
 
+// 修改item的一个属性(见QmTimelineItem::setProperty)，在属性修改之后创建
+class QMTIMELINE_LIB_EXPORT QmTimelineItemPropertyCommand : public QmTimelineMergeableCommand {
+public:
+    explicit QmTimelineItemPropertyCommand(
+        QmTimelineItemModel* model, QmItemID item_id, int role, const QVariant& old_value, QUndoCommand* parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand* other) override;
+
+private:
+    QmTimelineItemModel* model_ { nullptr };
+    QmItemID item_id_ { kInvalidItemID };
+    int role_ { 0 };
+    QVariant old_value_;
+    QVariant new_value_;
+};
+
 } // namespace qmtl
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include <functional>
 #include <limits>
+#include <map>
 #include <qtypes.h>
+#include <vector>
 
 namespace qmtl {
 
@@ -33,10 +35,44 @@ struct QmItemConnIDEqual {
     }
 };
 
+// {item_id: 以该item为一端的连接}
+using QmTimelineConnTable = std::map<QmItemID, QmItemConnID>;
+
+// 一次批量编辑的净变化，在批量编辑结束时一次性通知
+struct QmItemBatchChange {
+    std::vector<QmItemID> created;
+    std::vector<QmItemID> removed;
+    std::vector<QmItemConnID> conn_created;
+    std::vector<QmItemConnID> conn_removed;
+    // 受影响的行，升序
+    std::vector<int> rows;
+
+    bool isEmpty() const
+    {
+        return created.empty() && removed.empty() && conn_created.empty() && conn_removed.empty() && rows.empty();
+    }
+};
+
 enum class QmFrameFormat {
     Frame = 0,
     TimeCode,
     TimeString,
 };
 
+// 帧率转换时帧号的舍入方式
+enum class QmFrameRounding {
+    Nearest = 0,
+    Floor,
+    Ceil,
+};
+
+enum class QmShadowMode {
+    // 不绘制阴影，适合item数量很多的场景
+    None = 0,
+    // 共享的九宫格阴影图
+    Cached,
+    // 每个视图一个QGraphicsDropShadowEffect
+    Effect,
+};
+
 } // namespace qmtl
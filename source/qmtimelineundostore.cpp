@@ -0,0 +1,277 @@
+#include "qmtimelineundostore.h"
+#include "qmtimelinelog.h"
+#include <QTemporaryFile>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace qmtl {
+
+namespace {
+constexpr qint64 kDefaultMemoryBudget = 64 * 1024 * 1024;
+
+struct UndoEntry {
+    // 写入临时文件后清空
+    QByteArray data;
+    qint64 file_offset { -1 };
+    qint64 size { 0 };
+};
+} // namespace
+
+struct QmTimelineUndoStorePrivate {
+    qint64 memory_budget { kDefaultMemoryBudget };
+    qint64 memory_usage { 0 };
+    qint64 spilled_size { 0 };
+    quint64 next_key { 1 };
+    std::unordered_map<quint64, UndoEntry> entries;
+    // 按存入顺序排列的仍在内存中的数据，已释放的key在出队时跳过，
+    // 或在release()中累积过多时统一清理
+    std::deque<quint64> resident_keys;
+    std::unique_ptr<QTemporaryFile> file;
+    // 文件末尾的位置，spilled_size只统计仍在使用的数据
+    qint64 file_size { 0 };
+    // {offset: size} 文件中已释放的空洞，相邻的空洞合并，位于文件末尾时直接截断
+    std::map<qint64, qint64> free_extents;
+
+    qint64 allocate(qint64 size);
+    void deallocate(qint64 offset, qint64 size);
+};
+
+qint64 QmTimelineUndoStorePrivate::allocate(qint64 size)
+{
+    // 首次适配，复用已释放的空洞
+    for (auto it = free_extents.begin(); it != free_extents.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+        qint64 offset = it->first;
+        qint64 remain = it->second - size;
+        free_extents.erase(it);
+        if (remain > 0) {
+            free_extents.emplace(offset + size, remain);
+        }
+        return offset;
+    }
+    qint64 offset = file_size;
+    file_size += size;
+    return offset;
+}
+
+void QmTimelineUndoStorePrivate::deallocate(qint64 offset, qint64 size)
+{
+    auto next = free_extents.lower_bound(offset);
+    if (next != free_extents.end() && offset + size == next->first) {
+        size += next->second;
+        next = free_extents.erase(next);
+    }
+    if (next != free_extents.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            free_extents.erase(prev);
+        }
+    }
+    if (offset + size == file_size) {
+        // 末尾的空洞不再保留，文件随之缩小
+        file_size = offset;
+        file->resize(file_size);
+        return;
+    }
+    free_extents.emplace(offset, size);
+}
+
+QmTimelineUndoStore& QmTimelineUndoStore::instance()
+{
+    static QmTimelineUndoStore store;
+    return store;
+}
+
+QmTimelineUndoStore::QmTimelineUndoStore()
+    : d_(new QmTimelineUndoStorePrivate)
+{
+}
+
+QmTimelineUndoStore::~QmTimelineUndoStore() noexcept
+{
+    delete d_;
+}
+
+void QmTimelineUndoStore::setMemoryBudget(qint64 bytes)
+{
+    d_->memory_budget = qMax<qint64>(0, bytes);
+    spill();
+}
+
+qint64 QmTimelineUndoStore::memoryBudget() const
+{
+    return d_->memory_budget;
+}
+
+qint64 QmTimelineUndoStore::memoryUsage() const
+{
+    return d_->memory_usage;
+}
+
+qint64 QmTimelineUndoStore::spilledSize() const
+{
+    return d_->spilled_size;
+}
+
+quint64 QmTimelineUndoStore::put(QByteArray data)
+{
+    quint64 key = d_->next_key++;
+    qint64 size = data.size();
+    d_->entries.emplace(key, UndoEntry { std::move(data), -1, size });
+    d_->resident_keys.push_back(key);
+    d_->memory_usage += size;
+    spill();
+    return key;
+}
+
+QByteArray QmTimelineUndoStore::get(quint64 key) const
+{
+    auto it = d_->entries.find(key);
+    if (it == d_->entries.end()) {
+        return {};
+    }
+    const auto& entry = it->second;
+    if (entry.file_offset < 0) {
+        return entry.data;
+    }
+    // 读回的数据不再放回内存，撤销之后通常不会马上再次使用
+    if (!d_->file->seek(entry.file_offset)) {
+        QMTL_LOG_ERROR("Failed to read undo data. {}", d_->file->errorString().toStdString());
+        return {};
+    }
+    QByteArray data = d_->file->read(entry.size);
+    if (data.size() != entry.size) {
+        QMTL_LOG_ERROR("Failed to read undo data. {}", d_->file->errorString().toStdString());
+        return {};
+    }
+    return data;
+}
+
+void QmTimelineUndoStore::release(quint64 key)
+{
+    auto it = d_->entries.find(key);
+    if (it == d_->entries.end()) {
+        return;
+    }
+    if (it->second.file_offset < 0) {
+        d_->memory_usage -= it->second.size;
+    } else {
+        d_->spilled_size -= it->second.size;
+        d_->deallocate(it->second.file_offset, it->second.size);
+    }
+    d_->entries.erase(it);
+
+    // 内存预算足够时spill()不会出队，已释放的key需要在这里清理
+    auto& keys = d_->resident_keys;
+    while (!keys.empty() && !d_->entries.contains(keys.front())) {
+        keys.pop_front();
+    }
+    // 队首的数据长期存活时，已释放的key超过存活数量才整体清理一次，均摊O(1)
+    if (keys.size() > 2 * d_->entries.size() + 64) {
+        std::erase_if(keys, [this](quint64 k) { return !d_->entries.contains(k); });
+    }
+}
+
+void QmTimelineUndoStore::spill()
+{
+    while (d_->memory_usage > d_->memory_budget && !d_->resident_keys.empty()) {
+        quint64 key = d_->resident_keys.front();
+        auto it = d_->entries.find(key);
+        if (it == d_->entries.end() || it->second.file_offset >= 0) {
+            d_->resident_keys.pop_front();
+            continue;
+        }
+        if (!d_->file) {
+            auto file = std::make_unique<QTemporaryFile>();
+            if (!file->open()) {
+                QMTL_LOG_WARN("Failed to create undo spill file. {}", file->errorString().toStdString());
+                return;
+            }
+            d_->file = std::move(file);
+        }
+
+        auto& entry = it->second;
+        qint64 offset = d_->allocate(entry.size);
+        if (!d_->file->seek(offset) || d_->file->write(entry.data) != entry.size) {
+            // 写入失败时数据留在内存中，超出预算也不丢弃
+            QMTL_LOG_WARN("Failed to spill undo data. {}", d_->file->errorString().toStdString());
+            d_->deallocate(offset, entry.size);
+            return;
+        }
+        entry.data = QByteArray();
+        entry.file_offset = offset;
+        d_->spilled_size += entry.size;
+        d_->memory_usage -= entry.size;
+        d_->resident_keys.pop_front();
+    }
+}
+
+QmTimelineUndoPayload::QmTimelineUndoPayload(QByteArray data)
+    : key_(QmTimelineUndoStore::instance().put(std::move(data)))
+{
+}
+
+QmTimelineUndoPayload::~QmTimelineUndoPayload() noexcept
+{
+    if (key_ != 0) {
+        QmTimelineUndoStore::instance().release(key_);
+    }
+}
+
+QmTimelineUndoPayload::QmTimelineUndoPayload(QmTimelineUndoPayload&& other) noexcept
+    : key_(std::exchange(other.key_, 0))
+{
+}
+
+QmTimelineUndoPayload& QmTimelineUndoPayload::operator=(QmTimelineUndoPayload&& other) noexcept
+{
+    if (this != &other) {
+        if (key_ != 0) {
+            QmTimelineUndoStore::instance().release(key_);
+        }
+        key_ = std::exchange(other.key_, 0);
+    }
+    return *this;
+}
+
+QmTimelineUndoPayload QmTimelineUndoPayload::fromJson(const nlohmann::json& j)
+{
+    std::vector<std::uint8_t> cbor = nlohmann::json::to_cbor(j);
+    return QmTimelineUndoPayload(QByteArray(reinterpret_cast<const char*>(cbor.data()), static_cast<qsizetype>(cbor.size())));
+}
+
+bool QmTimelineUndoPayload::isNull() const
+{
+    return key_ == 0;
+}
+
+QByteArray QmTimelineUndoPayload::data() const
+{
+    if (key_ == 0) {
+        return {};
+    }
+    return QmTimelineUndoStore::instance().get(key_);
+}
+
+nlohmann::json QmTimelineUndoPayload::json() const
+{
+    QByteArray bytes = data();
+    if (bytes.isEmpty()) {
+        return {};
+    }
+    auto j = nlohmann::json::from_cbor(bytes.cbegin(), bytes.cend(), true, false);
+    if (j.is_discarded()) {
+        QMTL_LOG_ERROR("Failed to decode undo data.");
+        return {};
+    }
+    return j;
+}
+
+} // namespace qmtl
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "qmtimeline_global.h"
+#include "nlohmann/json.hpp"
+#include <QByteArray>
+
+namespace qmtl {
+
+struct QmTimelineUndoStorePrivate;
+// 撤销命令数据的存储。
+// 数据以紧凑的二进制形式保存在内存中，总量超过内存预算时，最早存入的数据写入临时文件，
+// 撤销到对应的命令时再从文件读回。只能在GUI线程使用。
+class QMTIMELINE_LIB_EXPORT QmTimelineUndoStore {
+public:
+    static QmTimelineUndoStore& instance();
+
+    // 默认64MB
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    // 保存在内存中/临时文件中的数据量，临时文件中已释放的空间由之后写入的数据复用
+    qint64 memoryUsage() const;
+    qint64 spilledSize() const;
+
+    quint64 put(QByteArray data);
+    // 读取失败时返回空数据
+    QByteArray get(quint64 key) const;
+    void release(quint64 key);
+
+private:
+    QmTimelineUndoStore();
+    ~QmTimelineUndoStore() noexcept;
+    Q_DISABLE_COPY_MOVE(QmTimelineUndoStore)
+
+    void spill();
+
+private:
+    QmTimelineUndoStorePrivate* d_ { nullptr };
+};
+
+// 撤销命令持有的一份数据，析构时从QmTimelineUndoStore中释放
+class QMTIMELINE_LIB_EXPORT QmTimelineUndoPayload {
+public:
+    QmTimelineUndoPayload() = default;
+    explicit QmTimelineUndoPayload(QByteArray data);
+    ~QmTimelineUndoPayload() noexcept;
+    QmTimelineUndoPayload(QmTimelineUndoPayload&& other) noexcept;
+    QmTimelineUndoPayload& operator=(QmTimelineUndoPayload&& other) noexcept;
+
+    // 以CBOR编码保存
+    static QmTimelineUndoPayload fromJson(const nlohmann::json& j);
+
+    bool isNull() const;
+    // 数据丢失(例如临时文件读取失败)时分别返回空数据和null
+    QByteArray data() const;
+    nlohmann::json json() const;
+
+private:
+    Q_DISABLE_COPY(QmTimelineUndoPayload)
+    quint64 key_ { 0 };
+};
+
+} // namespace qmtl
@@ -289,7 +289,7 @@ void QmTimelineView::onViewFrameMaximumChanged(qint64 value)
         d_->ranger->slider()->setViewFrameMaximum(value);
     }
     d_->axis->setMaximum(value);
-    d_->scene->fitInAxis();
+    d_->scene->scheduleFitInAxis();
 }
 
 void QmTimelineView::onViewFrameMinimumChanged(qint64 value)
@@ -302,7 +302,7 @@ void QmTimelineView::onViewFrameMinimumChanged(qint64 value)
         d_->ranger->slider()->setViewFrameMinimum(value);
     }
     d_->axis->setMinimum(value);
-    d_->scene->fitInAxis();
+    d_->scene->scheduleFitInAxis();
 }
 
 void QmTimelineView::onFrameMaximumChanged(qint64 value)
@@ -380,6 +380,11 @@ qreal QmTimelineView::axisFramePixels() const
     return d_->axis->framePixels();
 }
 
+qint64 QmTimelineView::axisTickFrames() const
+{
+    return d_->axis->tickFrames();
+}
+
 qint64 QmTimelineView::axisFrameNo() const
 {
     return d_->axis->frame();
@@ -24,6 +24,8 @@ public:
     int axisPlayheadHeight() const;
     // 关键帧的像素宽度
     qreal axisFramePixels() const;
+    // 标尺相邻刻度之间的帧数
+    qint64 axisTickFrames() const;
     qint64 axisFrameNo() const;
     QmTimelineItemModel* model() const;
 
@@ -303,6 +303,12 @@ qreal QmTimelineAxis::framePixels() const
     return d_->ruler.frame_pixels;
 }
 
+qint64 QmTimelineAxis::tickFrames() const
+{
+    // 刻度宽度是帧宽度的整数倍
+    return qMax<qint64>(1, qRound64(tickUnit()));
+}
+
 qint64 QmTimelineAxis::frameCount() const
 {
     return d_->ruler.maximum - d_->ruler.minimum + 1;
@@ -36,6 +36,8 @@ public:
 
     qint64 frame() const;
     qreal framePixels() const;
+    // 相邻刻度之间的帧数，刻度从minimum()开始
+    qint64 tickFrames() const;
 
     void setPlayheadHeight(qreal height);
     qreal playheadHeight() const;
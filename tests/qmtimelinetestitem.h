@@ -0,0 +1,69 @@
+#pragma once
+
+#include "qmtimelineitem.h"
+#include "qmtimelineitemfactory.h"
+
+namespace qmtl {
+
+// 测试用的item类型，label保存在payload中，用于检查二进制快照和撤销数据的往返
+class QmTimelineTestItem : public QmTimelineItem {
+public:
+    static constexpr int kType = 42;
+
+    using QmTimelineItem::QmTimelineItem;
+
+    QString typeName() const override
+    {
+        return QStringLiteral("TestItem");
+    }
+
+    int type() const override
+    {
+        return kType;
+    }
+
+    QString label() const
+    {
+        return label_;
+    }
+
+    void setLabel(const QString& label)
+    {
+        label_ = label;
+        setDirty(true);
+        notifyPropertyChanged(ToolTipRole);
+    }
+
+    bool load(const nlohmann::json& j) override
+    {
+        if (!QmTimelineItem::load(j)) {
+            return false;
+        }
+        label_ = QString::fromStdString(j.value("label", std::string()));
+        return true;
+    }
+
+    nlohmann::json save() const override
+    {
+        auto j = QmTimelineItem::save();
+        j["label"] = label_.toStdString();
+        return j;
+    }
+
+    static void registerType()
+    {
+        static const bool registered = [] {
+            auto creator = std::make_unique<QmTimelineItemCreateor>();
+            creator->item_creator = [](QmItemID item_id, QmTimelineItemModel* model) -> std::unique_ptr<QmTimelineItem> {
+                return std::make_unique<QmTimelineTestItem>(item_id, model);
+            };
+            return QmTimelineItemFactory::instance().registerItemType(kType, std::move(creator));
+        }();
+        Q_UNUSED(registered);
+    }
+
+private:
+    QString label_;
+};
+
+} // namespace qmtl
@@ -0,0 +1,190 @@
+#include "qmtimelinebinary.h"
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinetestitem.h"
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+
+using namespace qmtl;
+
+class TestQmTimelineBinary : public QObject {
+    Q_OBJECT
+
+private:
+    // 4行，每行item_count个互不相邻的item，label为序号
+    static std::vector<QmItemID> fillModel(QmTimelineItemModel& model, int item_count)
+    {
+        model.setFrameMaximum(item_count * 20);
+        model.setViewFrameMaximum(item_count * 20);
+        std::vector<QmItemID> item_ids;
+        for (int i = 0; i < item_count * 4; ++i) {
+            QmItemID item_id = model.createItem(QmTimelineTestItem::kType, i % 4, (i / 4) * 20, 10);
+            model.item<QmTimelineTestItem>(item_id)->setLabel(QString::number(i));
+            item_ids.push_back(item_id);
+        }
+        return item_ids;
+    }
+
+    static void compareModels(const QmTimelineItemModel& actual, const QmTimelineItemModel& expected, const std::vector<QmItemID>& item_ids)
+    {
+        QCOMPARE(actual.fps(), expected.fps());
+        QCOMPARE(actual.frameMaximum(), expected.frameMaximum());
+        QCOMPARE(actual.viewFrameMaximum(), expected.viewFrameMaximum());
+        QCOMPARE(actual.rowIds(), expected.rowIds());
+        for (auto item_id : item_ids) {
+            auto* actual_item = actual.item<QmTimelineTestItem>(item_id);
+            auto* expected_item = expected.item<QmTimelineTestItem>(item_id);
+            QVERIFY(actual_item);
+            QCOMPARE(actual_item->start(), expected_item->start());
+            QCOMPARE(actual_item->duration(), expected_item->duration());
+            QCOMPARE(actual_item->label(), expected_item->label());
+            QCOMPARE(actual.nextConnection(item_id).to, expected.nextConnection(item_id).to);
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QmTimelineTestItem::registerType();
+    }
+
+    void roundTrip()
+    {
+        QmTimelineItemModel model;
+        auto item_ids = fillModel(model, 50);
+        model.createFrameConnection(item_ids[0], item_ids[4]);
+        model.setRowHidden(2, true);
+
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::ReadWrite));
+        QVERIFY(model.saveBinary(buffer));
+        buffer.seek(0);
+
+        QmTimelineItemModel loaded;
+        QVERIFY(loaded.loadBinary(buffer));
+        QVERIFY(loaded.isRowHidden(2));
+        compareModels(loaded, model, item_ids);
+    }
+
+    void mappedRoundTrip()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString file_path = dir.filePath(QStringLiteral("project.qmtl"));
+
+        QmTimelineItemModel model;
+        auto item_ids = fillModel(model, 50);
+        QVERIFY(model.saveBinary(file_path));
+
+        QmTimelineItemModel mapped;
+        QVERIFY(mapped.loadMapped(file_path));
+        QVERIFY(!mapped.isItemMaterialized(item_ids.back()));
+        compareModels(mapped, model, item_ids);
+    }
+
+    // 映射加载之后保存回同一个文件：未创建item的payload不能在写出时失效
+    void mappedSaveToSamePath()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString file_path = dir.filePath(QStringLiteral("project.qmtl"));
+
+        QmTimelineItemModel model;
+        auto item_ids = fillModel(model, 1000);
+        QVERIFY(model.saveBinary(file_path));
+
+        QmTimelineItemModel mapped;
+        QVERIFY(mapped.loadMapped(file_path));
+        // 只创建一个item并修改，其余item的payload仍然引用映射的文件
+        mapped.item<QmTimelineTestItem>(item_ids[0])->setLabel(QStringLiteral("changed"));
+        model.item<QmTimelineTestItem>(item_ids[0])->setLabel(QStringLiteral("changed"));
+        QVERIFY(!mapped.isItemMaterialized(item_ids.back()));
+
+        // 直接截断映射的文件会被拒绝，文件保持不变
+        QFile file(file_path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(!mapped.saveBinary(file));
+        file.close();
+
+        QVERIFY(mapped.saveBinary(file_path));
+        // 原来的映射已复制到内存，尚未创建的item仍然可以读取
+        QVERIFY(!mapped.isItemMaterialized(item_ids.back()));
+        compareModels(mapped, model, item_ids);
+
+        QmTimelineItemModel reloaded;
+        QVERIFY(reloaded.loadMapped(file_path));
+        compareModels(reloaded, model, item_ids);
+
+        // 所有item都已创建但映射仍然打开，再次保存到同一路径
+        QVERIFY(reloaded.saveBinary(file_path));
+        QmTimelineItemModel reloaded_again;
+        QVERIFY(reloaded_again.loadMapped(file_path));
+        compareModels(reloaded_again, model, item_ids);
+    }
+
+    void corruptRecords_data()
+    {
+        // 修改的位置: 记录序号(-1为文件头)、字段在记录中的偏移、写入的值
+        QTest::addColumn<int>("record");
+        QTest::addColumn<int>("field_offset");
+        QTest::addColumn<qint64>("value");
+
+        QTest::newRow("negative duration") << 0 << 16 << qint64(-1);
+        // 第二个item [10, 15] 改为 [3, 8]，与第一个item [0, 5] 重叠
+        QTest::newRow("overlap") << 1 << 8 << qint64(3);
+        // 文件头中的id_index不大于第二个item的序号
+        QTest::newRow("id beyond id_index") << -1 << 8 << qint64(2);
+        // 覆盖magic和version，文件头无效
+        QTest::newRow("bad header") << -1 << 0 << qint64(0);
+    }
+
+    // 无效的记录使加载失败，模型中不保留加载了一半的item，映射也被关闭
+    void corruptRecords()
+    {
+        QFETCH(int, record);
+        QFETCH(int, field_offset);
+        QFETCH(qint64, value);
+
+        QmTimelineItemModel model;
+        model.setFrameMaximum(100);
+        model.setViewFrameMaximum(100);
+        model.createItem(QmTimelineTestItem::kType, 0, 0, 5);
+        model.createItem(QmTimelineTestItem::kType, 0, 10, 5);
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::ReadWrite));
+        QVERIFY(model.saveBinary(buffer));
+
+        QByteArray data = buffer.data();
+        QmTimelineBinaryHeader header;
+        QVERIFY(QmTimelineBinaryFormat::readHeader(data.constData(), data.size(), header));
+        qsizetype offset = field_offset;
+        if (record >= 0) {
+            offset += static_cast<qsizetype>(header.items_offset) + record * QmTimelineBinaryFormat::kItemRecordSize;
+        }
+        qToLittleEndian<qint64>(value, data.data() + offset);
+
+        QBuffer corrupt(&data);
+        QVERIFY(corrupt.open(QIODevice::ReadOnly));
+        QmTimelineItemModel loaded;
+        QVERIFY(!loaded.loadBinary(corrupt));
+        QVERIFY(loaded.rowIds().empty());
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString file_path = dir.filePath(QStringLiteral("corrupt.qmtl"));
+        QFile file(file_path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(data), data.size());
+        file.close();
+        QmTimelineItemModel mapped;
+        QVERIFY(!mapped.loadMapped(file_path));
+        QVERIFY(mapped.rowIds().empty());
+        // 映射已关闭，文件可以删除
+        QVERIFY(QFile::remove(file_path));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelineBinary)
+#include "tst_qmtimelinebinary.moc"
@@ -0,0 +1,175 @@
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinerowindex.h"
+#include "qmtimelinetestitem.h"
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace qmtl;
+
+class TestQmTimelineConvertFps : public QObject {
+    Q_OBJECT
+
+private:
+    static void prepareModel(QmTimelineItemModel& model)
+    {
+        QCOMPARE(model.fps(), 24.0);
+        model.setFrameMaximum(101);
+        model.setViewFrameMaximum(101);
+    }
+
+    // 行索引与item的区间一致，且行内互不重叠
+    static void verifyRows(const QmTimelineItemModel& model)
+    {
+        for (int row_id : model.rowIds()) {
+            const auto* index = model.rowIndex(row_id);
+            QVERIFY(index);
+            for (qsizetype pos = 0; pos < index->size(); ++pos) {
+                auto* item = model.item(index->idAt(pos));
+                QVERIFY(item);
+                QCOMPARE(item->start(), index->startAt(pos));
+                QCOMPARE(item->end(), index->endAt(pos));
+                if (pos > 0) {
+                    QVERIFY(index->startAt(pos) > index->endAt(pos - 1));
+                }
+            }
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QmTimelineTestItem::registerType();
+    }
+
+    void rounding_data()
+    {
+        QTest::addColumn<double>("fps");
+        QTest::addColumn<QmFrameRounding>("rounding");
+        QTest::addColumn<qint64>("start");
+        QTest::addColumn<qint64>("duration");
+
+        // [3, 5]减半：start为1.5，end按下一帧的起点6缩放为3，即end为2
+        QTest::newRow("half nearest") << 12.0 << QmFrameRounding::Nearest << qint64(2) << qint64(0);
+        QTest::newRow("half floor") << 12.0 << QmFrameRounding::Floor << qint64(1) << qint64(1);
+        QTest::newRow("half ceil") << 12.0 << QmFrameRounding::Ceil << qint64(2) << qint64(0);
+        // [3, 5]乘以1.25：start为3.75，下一帧的起点6缩放为7.5，Nearest/Ceil取8，Floor取7
+        QTest::newRow("up nearest") << 30.0 << QmFrameRounding::Nearest << qint64(4) << qint64(3);
+        QTest::newRow("up floor") << 30.0 << QmFrameRounding::Floor << qint64(3) << qint64(3);
+        QTest::newRow("up ceil") << 30.0 << QmFrameRounding::Ceil << qint64(4) << qint64(3);
+    }
+
+    void rounding()
+    {
+        QFETCH(double, fps);
+        QFETCH(QmFrameRounding, rounding);
+        QFETCH(qint64, start);
+        QFETCH(qint64, duration);
+
+        QmTimelineItemModel model;
+        prepareModel(model);
+        QmItemID item_id = model.createItem(QmTimelineTestItem::kType, 0, 3, 2);
+        QSignalSpy retimed(&model, &QmTimelineItemModel::itemsRetimed);
+
+        QVERIFY(model.convertFps(fps, rounding));
+        QCOMPARE(retimed.count(), 1);
+        QCOMPARE(model.fps(), fps);
+        QCOMPARE(model.item(item_id)->start(), start);
+        QCOMPARE(model.item(item_id)->duration(), duration);
+        verifyRows(model);
+    }
+
+    void adjacentItemsStayAdjacent()
+    {
+        QmTimelineItemModel model;
+        prepareModel(model);
+        // 首尾相接的item，end按下一帧的起点缩放，转换后仍然首尾相接
+        QmItemID a = model.createItem(QmTimelineTestItem::kType, 0, 0, 9);
+        QmItemID b = model.createItem(QmTimelineTestItem::kType, 0, 10, 9);
+        QmItemID c = model.createItem(QmTimelineTestItem::kType, 0, 20, 9);
+
+        QVERIFY(model.convertFps(30.0));
+        QCOMPARE(model.item(a)->start(), qint64(0));
+        QCOMPARE(model.item(a)->end() + 1, model.item(b)->start());
+        QCOMPARE(model.item(b)->end() + 1, model.item(c)->start());
+        QCOMPARE(model.item(c)->end(), qint64(37));
+        verifyRows(model);
+    }
+
+    void collisionsPushedRight()
+    {
+        QmTimelineItemModel model;
+        prepareModel(model);
+        // 每帧一个item，减半并向下取整后第二个item与第一个重合，依次后推
+        std::vector<QmItemID> dense;
+        for (int frame = 0; frame < 3; ++frame) {
+            dense.push_back(model.createItem(QmTimelineTestItem::kType, 0, frame, 0));
+        }
+        QmItemID far = model.createItem(QmTimelineTestItem::kType, 0, 10, 4);
+        // 另一行不受影响
+        QmItemID other = model.createItem(QmTimelineTestItem::kType, 1, 1, 0);
+
+        QVERIFY(model.convertFps(12.0, QmFrameRounding::Floor));
+        for (int i = 0; i < 3; ++i) {
+            QCOMPARE(model.item(dense[i])->start(), qint64(i));
+            QCOMPARE(model.item(dense[i])->duration(), qint64(0));
+        }
+        QCOMPARE(model.item(far)->start(), qint64(5));
+        QCOMPARE(model.item(far)->end(), qint64(6));
+        QCOMPARE(model.item(other)->start(), qint64(0));
+        verifyRows(model);
+    }
+
+    void frameRanges()
+    {
+        QmTimelineItemModel model;
+        prepareModel(model);
+        model.createItem(QmTimelineTestItem::kType, 0, 100, 1);
+
+        QVERIFY(model.convertFps(12.0));
+        // 范围向外舍入
+        QCOMPARE(model.frameMaximum(), qint64(51));
+        QCOMPARE(model.viewFrameMaximum(), qint64(51));
+        QCOMPARE(model.frameMinimum(), qint64(0));
+
+        // 帧率相同不做修改，无效的帧率被拒绝
+        QSignalSpy retimed(&model, &QmTimelineItemModel::itemsRetimed);
+        QVERIFY(model.convertFps(12.0));
+        QVERIFY(!model.convertFps(0.0));
+        QCOMPARE(retimed.count(), 0);
+        QCOMPARE(model.fps(), 12.0);
+    }
+
+    // 映射加载后尚未创建的item只记录偏移量，创建时得到与直接转换相同的结果
+    void lazyItemsMatchCreatedItems()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString file_path = dir.filePath(QStringLiteral("project.qmtl"));
+
+        QmTimelineItemModel model;
+        prepareModel(model);
+        std::vector<QmItemID> item_ids;
+        for (int i = 0; i < 20; ++i) {
+            item_ids.push_back(model.createItem(QmTimelineTestItem::kType, i % 2, (i / 2) * 7, i % 5));
+        }
+        QVERIFY(model.saveBinary(file_path));
+
+        QmTimelineItemModel mapped;
+        QVERIFY(mapped.loadMapped(file_path));
+        // 先创建一个item，转换时同时经过已创建和未创建两种路径
+        QVERIFY(mapped.item(item_ids[0]));
+
+        QVERIFY(model.convertFps(25.0));
+        QVERIFY(mapped.convertFps(25.0));
+        QVERIFY(!mapped.isItemMaterialized(item_ids.back()));
+        for (auto item_id : item_ids) {
+            QCOMPARE(mapped.item(item_id)->start(), model.item(item_id)->start());
+            QCOMPARE(mapped.item(item_id)->duration(), model.item(item_id)->duration());
+        }
+        verifyRows(mapped);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelineConvertFps)
+#include "tst_qmtimelineconvertfps.moc"
@@ -0,0 +1,168 @@
+#include "qmtimelineitemmodel.h"
+#include "qmtimelineplaybackcursor.h"
+#include "qmtimelinetestitem.h"
+#include <QTest>
+
+using namespace qmtl;
+
+class TestQmTimelinePlaybackCursor : public QObject {
+    Q_OBJECT
+
+private:
+    // 按发出顺序记录游标的事件，item以label表示
+    class EventRecorder {
+    public:
+        EventRecorder(QmTimelineItemModel& model, QmTimelinePlaybackCursor& cursor)
+            : model_(model)
+        {
+            QObject::connect(&cursor, &QmTimelinePlaybackCursor::itemEntered, [this](QmItemID item_id) { record("enter", item_id); });
+            QObject::connect(&cursor, &QmTimelinePlaybackCursor::itemExited, [this](QmItemID item_id) { record("exit", item_id); });
+            QObject::connect(&cursor, &QmTimelinePlaybackCursor::itemSkipped, [this](QmItemID item_id) { record("skip", item_id); });
+        }
+
+        QStringList take()
+        {
+            return std::exchange(events_, {});
+        }
+
+    private:
+        void record(const char* kind, QmItemID item_id)
+        {
+            events_.append(QStringLiteral("%1 %2").arg(QLatin1String(kind), model_.item<QmTimelineTestItem>(item_id)->label()));
+        }
+
+        QmTimelineItemModel& model_;
+        QStringList events_;
+    };
+
+    static QmItemID addItem(QmTimelineItemModel& model, int row_id, qint64 start, qint64 duration, const QString& label)
+    {
+        QmItemID item_id = model.createItem(QmTimelineTestItem::kType, row_id, start, duration);
+        model.item<QmTimelineTestItem>(item_id)->setLabel(label);
+        return item_id;
+    }
+
+    // 行0: A[10, 20] B[30, 35]，行1: C[15, 40]
+    static void fillModel(QmTimelineItemModel& model)
+    {
+        model.setFrameMaximum(1000);
+        model.setViewFrameMaximum(1000);
+        addItem(model, 0, 10, 10, QStringLiteral("A"));
+        addItem(model, 0, 30, 5, QStringLiteral("B"));
+        addItem(model, 1, 15, 25, QStringLiteral("C"));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QmTimelineTestItem::registerType();
+    }
+
+    void enterAndExit()
+    {
+        QmTimelineItemModel model;
+        fillModel(model);
+        QmTimelinePlaybackCursor cursor(&model);
+        EventRecorder recorder(model, cursor);
+
+        cursor.seek(0);
+        QVERIFY(recorder.take().isEmpty());
+
+        cursor.advanceTo(10);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("enter A") });
+        // 区间是闭区间，A在end帧仍然活动
+        cursor.advanceTo(20);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("enter C") });
+        QCOMPARE(cursor.activeItems().size(), std::size_t(2));
+
+        cursor.advanceTo(21);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("exit A") });
+        QCOMPARE(cursor.activeItem(0), kInvalidItemID);
+        QCOMPARE(cursor.frame(), qint64(21));
+    }
+
+    void eventsInFrameOrder()
+    {
+        QmTimelineItemModel model;
+        fillModel(model);
+        QmTimelinePlaybackCursor cursor(&model);
+        EventRecorder recorder(model, cursor);
+
+        cursor.seek(0);
+        cursor.advanceTo(12);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("enter A") });
+
+        // 一次推进跨过多个事件：C在15开始、40结束，A在21离开，B在30开始、35结束
+        cursor.advanceTo(50);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("skip C"), QStringLiteral("exit A"), QStringLiteral("skip B") }));
+        QVERIFY(cursor.activeItems().empty());
+    }
+
+    void sameFrameOrderedByRow()
+    {
+        QmTimelineItemModel model;
+        model.setFrameMaximum(1000);
+        model.setViewFrameMaximum(1000);
+        addItem(model, 2, 10, 5, QStringLiteral("R2"));
+        addItem(model, 0, 10, 5, QStringLiteral("R0"));
+        addItem(model, 1, 10, 5, QStringLiteral("R1"));
+        QmTimelinePlaybackCursor cursor(&model);
+        EventRecorder recorder(model, cursor);
+
+        cursor.seek(0);
+        cursor.advanceTo(10);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("enter R0"), QStringLiteral("enter R1"), QStringLiteral("enter R2") }));
+        cursor.advanceTo(16);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("exit R0"), QStringLiteral("exit R1"), QStringLiteral("exit R2") }));
+    }
+
+    void seekDoesNotSkip()
+    {
+        QmTimelineItemModel model;
+        fillModel(model);
+        QmTimelinePlaybackCursor cursor(&model);
+        EventRecorder recorder(model, cursor);
+
+        cursor.seek(0);
+        cursor.seek(100);
+        QVERIFY(recorder.take().isEmpty());
+
+        cursor.seek(17);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("enter A"), QStringLiteral("enter C") }));
+
+        // 向前推进按seek处理
+        cursor.advanceTo(5);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("exit A"), QStringLiteral("exit C") }));
+        QCOMPARE(cursor.frame(), qint64(5));
+    }
+
+    void modelChangesInvalidateRows()
+    {
+        QmTimelineItemModel model;
+        fillModel(model);
+        QmTimelinePlaybackCursor cursor(&model);
+        EventRecorder recorder(model, cursor);
+
+        cursor.seek(12);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("enter A") });
+
+        // 活动item被移走后，下一次推进时离开
+        QmItemID a = cursor.activeItem(0);
+        QVERIFY(model.modifyItemStart(a, 0));
+        cursor.advanceTo(13);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("exit A") });
+
+        // 新建的item覆盖当前帧时进入
+        addItem(model, 2, 0, 100, QStringLiteral("D"));
+        cursor.advanceTo(14);
+        QCOMPARE(recorder.take(), QStringList { QStringLiteral("enter D") });
+
+        // 波纹编辑把B平移到当前帧，平移量受A[0, 10]限制，B变为[11, 16]
+        QCOMPARE(model.rippleRow(0, 30, -25), qint64(-19));
+        cursor.advanceTo(15);
+        QCOMPARE(recorder.take(), (QStringList { QStringLiteral("enter B"), QStringLiteral("enter C") }));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelinePlaybackCursor)
+#include "tst_qmtimelineplaybackcursor.moc"
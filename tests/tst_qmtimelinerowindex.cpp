@@ -0,0 +1,217 @@
+#include "qmtimelinerowindex.h"
+#include <QTest>
+#include <limits>
+
+using namespace qmtl;
+
+class TestQmTimelineRowIndex : public QObject {
+    Q_OBJECT
+
+private:
+    // item i占用[i * 10, i * 10 + 5]，id为i + 1
+    static QmTimelineRowIndex makeIndex(int count)
+    {
+        QmTimelineRowIndex index;
+        for (int i = 0; i < count; ++i) {
+            index.insert(static_cast<QmItemID>(i + 1), i * 10, i * 10 + 5);
+        }
+        return index;
+    }
+
+    static std::vector<QmItemID> idsOf(const QmTimelineRowIndex& index)
+    {
+        std::vector<QmItemID> ids;
+        for (qsizetype pos = 0; pos < index.size(); ++pos) {
+            ids.push_back(index.idAt(pos));
+        }
+        return ids;
+    }
+
+    static bool isSorted(const QmTimelineRowIndex& index)
+    {
+        for (qsizetype pos = 1; pos < index.size(); ++pos) {
+            if (index.startAt(pos - 1) > index.startAt(pos) || index.endAt(pos - 1) > index.endAt(pos)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private slots:
+    void insertKeepsOrder()
+    {
+        QmTimelineRowIndex index;
+        QCOMPARE(index.insert(1, 20, 25), 0);
+        QCOMPARE(index.insert(2, 0, 5), 0);
+        QCOMPARE(index.insert(3, 40, 45), 2);
+        QCOMPARE(index.insert(4, 10, 15), 1);
+        QCOMPARE(index.size(), 4);
+        QVERIFY(isSorted(index));
+        QCOMPARE(idsOf(index), (std::vector<QmItemID> { 2, 4, 1, 3 }));
+        QCOMPARE(index.find(4, 10), 1);
+        QCOMPARE(index.find(4, 11), QmTimelineRowIndex::npos);
+        QCOMPARE(index.findById(3), 3);
+    }
+
+    // 无序的多个区间归并插入到头部、中间和尾部
+    void insertEntries()
+    {
+        auto index = makeIndex(3);
+        auto shared = index;
+        index.insert({ { 10, 50, 55 }, { 11, 6, 8 }, { 12, -10, -5 }, { 13, 16, 18 } });
+        QCOMPARE(index.size(), 7);
+        QVERIFY(isSorted(index));
+        QCOMPARE(idsOf(index), (std::vector<QmItemID> { 12, 1, 11, 2, 13, 3, 10 }));
+        QCOMPARE(index.find(13, 16), 4);
+        QCOMPARE(shared.size(), 3);
+
+        index.insert({});
+        QCOMPARE(index.size(), 7);
+    }
+
+    void bounds()
+    {
+        auto index = makeIndex(5);
+        QCOMPARE(index.lowerBound(10), 1);
+        QCOMPARE(index.lowerBound(11), 2);
+        QCOMPARE(index.upperBound(10), 2);
+        QCOMPARE(index.upperBound(-1), 0);
+        QCOMPARE(index.upperBound(std::numeric_limits<qint64>::max()), 5);
+        QCOMPARE(index.lowerBoundEnd(15), 1);
+        QCOMPARE(index.lowerBoundEnd(16), 2);
+    }
+
+    void moveForwardAndBackward()
+    {
+        auto index = makeIndex(5);
+        // id 2 从[10, 15]移到[36, 38]，越过id 3和id 4
+        QCOMPARE(index.move(1, 36, 38), 3);
+        QVERIFY(isSorted(index));
+        QCOMPARE(idsOf(index), (std::vector<QmItemID> { 1, 3, 4, 2, 5 }));
+        QCOMPARE(index.startAt(3), 36);
+        QCOMPARE(index.endAt(3), 38);
+
+        // id 5 移到最前面
+        QCOMPARE(index.move(4, -10, -5), 0);
+        QVERIFY(isSorted(index));
+        QCOMPARE(idsOf(index), (std::vector<QmItemID> { 5, 1, 3, 4, 2 }));
+
+        // 原地修改区间，位置不变
+        QCOMPARE(index.move(2, 21, 24), 2);
+        QCOMPARE(index.startAt(2), 21);
+        QCOMPARE(index.endAt(2), 24);
+    }
+
+    void eraseSingle()
+    {
+        auto index = makeIndex(3);
+        index.erase(1);
+        QCOMPARE(idsOf(index), (std::vector<QmItemID> { 1, 3 }));
+        QCOMPARE(index.startAt(1), 20);
+    }
+
+    void erasePositions_data()
+    {
+        QTest::addColumn<std::vector<qsizetype>>("positions");
+        QTest::addColumn<std::vector<QmItemID>>("expected");
+
+        QTest::newRow("none") << std::vector<qsizetype> {} << std::vector<QmItemID> { 1, 2, 3, 4, 5, 6 };
+        QTest::newRow("first") << std::vector<qsizetype> { 0 } << std::vector<QmItemID> { 2, 3, 4, 5, 6 };
+        QTest::newRow("last") << std::vector<qsizetype> { 5 } << std::vector<QmItemID> { 1, 2, 3, 4, 5 };
+        QTest::newRow("scattered") << std::vector<qsizetype> { 1, 3, 4 } << std::vector<QmItemID> { 1, 3, 6 };
+        QTest::newRow("all") << std::vector<qsizetype> { 0, 1, 2, 3, 4, 5 } << std::vector<QmItemID> {};
+    }
+
+    void erasePositions()
+    {
+        QFETCH(std::vector<qsizetype>, positions);
+        QFETCH(std::vector<QmItemID>, expected);
+
+        auto index = makeIndex(6);
+        index.erase(positions);
+        QCOMPARE(idsOf(index), expected);
+        for (qsizetype pos = 0; pos < index.size(); ++pos) {
+            // 保留的item区间随id一起移动
+            qint64 start = static_cast<qint64>(index.idAt(pos) - 1) * 10;
+            QCOMPARE(index.startAt(pos), start);
+            QCOMPARE(index.endAt(pos), start + 5);
+        }
+    }
+
+    void stab()
+    {
+        auto index = makeIndex(3);
+        QCOMPARE(index.stab(0), 0);
+        QCOMPARE(index.stab(5), 0);
+        QCOMPARE(index.stab(6), QmTimelineRowIndex::npos);
+        QCOMPARE(index.stab(10), 1);
+        QCOMPARE(index.stab(25), 2);
+        QCOMPARE(index.stab(26), QmTimelineRowIndex::npos);
+        QCOMPARE(index.stab(-1), QmTimelineRowIndex::npos);
+        QCOMPARE(QmTimelineRowIndex().stab(0), QmTimelineRowIndex::npos);
+    }
+
+    void overlapping()
+    {
+        auto index = makeIndex(5);
+
+        auto range = index.overlapping(5, 20);
+        QCOMPARE(range.first(), 0);
+        QCOMPARE(range.size(), 3);
+        QCOMPARE(range[0].id, QmItemID(1));
+        QCOMPARE(range[2].id, QmItemID(3));
+
+        // 落在两个item之间的空隙
+        QVERIFY(index.overlapping(6, 9).empty());
+        QVERIFY(index.overlapping(100, 200).empty());
+
+        range = index.overlapping(14, 31);
+        std::vector<QmItemID> ids;
+        for (const auto& entry : range) {
+            QVERIFY(entry.start <= 31 && entry.end >= 14);
+            ids.push_back(entry.id);
+        }
+        QCOMPARE(ids, (std::vector<QmItemID> { 2, 3, 4 }));
+
+        QCOMPARE(index.all().size(), 5);
+    }
+
+    void occupied()
+    {
+        auto index = makeIndex(3);
+        QVERIFY(index.isOccupied(5, 9));
+        QVERIFY(!index.isOccupied(6, 9));
+        QVERIFY(index.isOccupied(6, 10));
+        // 排除自身后移动到原位置附近
+        QVERIFY(!index.isOccupied(8, 13, 2));
+        QVERIFY(index.isOccupied(8, 13, 1));
+    }
+
+    void shift()
+    {
+        auto index = makeIndex(4);
+        index.shift({ 1, 2 }, 3);
+        QCOMPARE(index.startAt(1), 13);
+        QCOMPARE(index.endAt(2), 28);
+        QCOMPARE(index.startAt(3), 30);
+
+        index.shiftFrom(2, -2);
+        QCOMPARE(index.startAt(1), 13);
+        QCOMPARE(index.startAt(2), 21);
+        QCOMPARE(index.startAt(3), 28);
+        QVERIFY(isSorted(index));
+    }
+
+    void implicitSharing()
+    {
+        auto index = makeIndex(3);
+        QmTimelineRowIndex snapshot = index;
+        index.erase(0);
+        QCOMPARE(snapshot.size(), 3);
+        QCOMPARE(snapshot.idAt(0), QmItemID(1));
+        QCOMPARE(index.size(), 2);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelineRowIndex)
+#include "tst_qmtimelinerowindex.moc"
@@ -0,0 +1,148 @@
+#include "qmtimelineitemmodel.h"
+#include "qmtimelinetestitem.h"
+#include "qmtimelinetransaction.h"
+#include "qmtimelineundostore.h"
+#include <QTest>
+#include <array>
+
+using namespace qmtl;
+
+class TestQmTimelineUndo : public QObject {
+    Q_OBJECT
+
+private:
+    // 行0: A[0, 5] B[10, 15] C[20, 25] D[30, 35] E[40, 45]，连接A->B->C->D
+    static std::vector<QmItemID> fillModel(QmTimelineItemModel& model)
+    {
+        model.setFrameMaximum(100);
+        model.setViewFrameMaximum(100);
+        std::vector<QmItemID> item_ids;
+        for (int i = 0; i < 5; ++i) {
+            QmItemID item_id = model.createItem(QmTimelineTestItem::kType, 0, i * 10, 5);
+            model.item<QmTimelineTestItem>(item_id)->setLabel(QString(QChar('A' + i)));
+            item_ids.push_back(item_id);
+        }
+        for (int i = 0; i < 3; ++i) {
+            model.createFrameConnection(item_ids[i], item_ids[i + 1]);
+        }
+        return item_ids;
+    }
+
+    // item_ids中依次相连，其余没有连接
+    static void verifyChain(const QmTimelineItemModel& model, const std::vector<QmItemID>& item_ids)
+    {
+        QCOMPARE(model.previousConnection(item_ids.front()).isValid(), false);
+        for (std::size_t i = 0; i + 1 < item_ids.size(); ++i) {
+            QCOMPARE(model.nextConnection(item_ids[i]).to, item_ids[i + 1]);
+            QCOMPARE(model.previousConnection(item_ids[i + 1]).from, item_ids[i]);
+        }
+        QCOMPARE(model.nextConnection(item_ids.back()).isValid(), false);
+    }
+
+    static void verifyItem(const QmTimelineItemModel& model, QmItemID item_id, qint64 start, const QString& label)
+    {
+        auto* item = model.item<QmTimelineTestItem>(item_id);
+        QVERIFY(item);
+        QCOMPARE(item->start(), start);
+        QCOMPARE(item->duration(), qint64(5));
+        QCOMPARE(item->label(), label);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QmTimelineTestItem::registerType();
+    }
+
+    void cleanup()
+    {
+        QmTimelineUndoStore::instance().setMemoryBudget(64 * 1024 * 1024);
+    }
+
+    // 删除连续的B、C时在A、D之间建立连接，撤销时恢复原来的连接并移除该连接
+    void deleteRunWithBridge()
+    {
+        QmTimelineItemModel model;
+        auto ids = fillModel(model);
+        const auto [a, b, c, d, e] = std::array { ids[0], ids[1], ids[2], ids[3], ids[4] };
+
+        QmTimelineItemsDeleteCommand command(&model, { b, c });
+        command.redo();
+        QVERIFY(!model.exists(b));
+        QVERIFY(!model.exists(c));
+        QCOMPARE(model.rowItemCount(0), 3);
+        verifyChain(model, { a, d });
+
+        command.undo();
+        QCOMPARE(model.rowItemCount(0), 5);
+        verifyItem(model, b, 10, QStringLiteral("B"));
+        verifyItem(model, c, 20, QStringLiteral("C"));
+        verifyChain(model, { a, b, c, d });
+        QVERIFY(!model.previousConnection(e).isValid());
+        QCOMPARE(model.itemNumber(c), 3);
+
+        command.redo();
+        verifyChain(model, { a, d });
+        command.undo();
+        verifyChain(model, { a, b, c, d });
+    }
+
+    // 不相邻的两段分别在各自前后建立连接
+    void deleteSeparateRuns()
+    {
+        QmTimelineItemModel model;
+        auto ids = fillModel(model);
+        model.createFrameConnection(ids[3], ids[4]);
+
+        QmTimelineItemsDeleteCommand command(&model, { ids[3], ids[1] });
+        command.redo();
+        verifyChain(model, { ids[0], ids[2], ids[4] });
+
+        command.undo();
+        verifyChain(model, ids);
+        for (int i = 0; i < 5; ++i) {
+            verifyItem(model, ids[i], i * 10, QString(QChar('A' + i)));
+        }
+    }
+
+    // 粘贴的撤销与删除相同，重做时从保存的数据恢复
+    void createUndoRedo()
+    {
+        QmTimelineItemModel model;
+        auto ids = fillModel(model);
+
+        QmTimelineItemsCreateCommand command(&model, { ids[1], ids[2] });
+        // 第一次redo时item已经存在，不做修改
+        command.redo();
+        verifyChain(model, { ids[0], ids[1], ids[2], ids[3] });
+
+        command.undo();
+        QVERIFY(!model.exists(ids[1]));
+        verifyChain(model, { ids[0], ids[3] });
+
+        command.redo();
+        verifyItem(model, ids[1], 10, QStringLiteral("B"));
+        verifyChain(model, { ids[0], ids[1], ids[2], ids[3] });
+    }
+
+    // 撤销数据写入临时文件后仍能恢复
+    void spilledUndoData()
+    {
+        auto& store = QmTimelineUndoStore::instance();
+        store.setMemoryBudget(0);
+
+        QmTimelineItemModel model;
+        auto ids = fillModel(model);
+        QmTimelineItemsDeleteCommand command(&model, { ids[1], ids[2] });
+        QCOMPARE(store.memoryUsage(), qint64(0));
+        QVERIFY(store.spilledSize() > 0);
+
+        command.redo();
+        command.undo();
+        verifyItem(model, ids[1], 10, QStringLiteral("B"));
+        verifyChain(model, { ids[0], ids[1], ids[2], ids[3] });
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelineUndo)
+#include "tst_qmtimelineundo.moc"
@@ -0,0 +1,73 @@
+#include "qmtimelineundostore.h"
+#include <QTest>
+
+using namespace qmtl;
+
+class TestQmTimelineUndoStore : public QObject {
+    Q_OBJECT
+
+private slots:
+    void cleanup()
+    {
+        QmTimelineUndoStore::instance().setMemoryBudget(64 * 1024 * 1024);
+    }
+
+    void residentData()
+    {
+        auto& store = QmTimelineUndoStore::instance();
+        const qint64 base_usage = store.memoryUsage();
+        {
+            QmTimelineUndoPayload payload(QByteArray(100, 'a'));
+            QCOMPARE(store.memoryUsage(), base_usage + 100);
+            QCOMPARE(payload.data(), QByteArray(100, 'a'));
+        }
+        QCOMPARE(store.memoryUsage(), base_usage);
+    }
+
+    // 临时文件中释放的空间被之后写入的数据复用，复用后读回的数据不变
+    void spillFileReuse()
+    {
+        auto& store = QmTimelineUndoStore::instance();
+        store.setMemoryBudget(0);
+        const qint64 base_size = store.spilledSize();
+
+        QmTimelineUndoPayload first(QByteArray(100, 'a'));
+        QmTimelineUndoPayload second(QByteArray(100, 'b'));
+        QmTimelineUndoPayload third(QByteArray(100, 'c'));
+        QCOMPARE(store.memoryUsage(), qint64(0));
+        QCOMPARE(store.spilledSize(), base_size + 300);
+
+        second = QmTimelineUndoPayload();
+        QCOMPARE(store.spilledSize(), base_size + 200);
+
+        QmTimelineUndoPayload small(QByteArray(40, 'd'));
+        QmTimelineUndoPayload large(QByteArray(80, 'e'));
+        QCOMPARE(store.spilledSize(), base_size + 320);
+        QCOMPARE(first.data(), QByteArray(100, 'a'));
+        QCOMPARE(third.data(), QByteArray(100, 'c'));
+        QCOMPARE(small.data(), QByteArray(40, 'd'));
+        QCOMPARE(large.data(), QByteArray(80, 'e'));
+
+        first = QmTimelineUndoPayload();
+        third = QmTimelineUndoPayload();
+        small = QmTimelineUndoPayload();
+        large = QmTimelineUndoPayload();
+        QCOMPARE(store.spilledSize(), base_size);
+    }
+
+    void jsonRoundTrip()
+    {
+        nlohmann::json j = { { "id", 42 }, { "label", "text" } };
+        auto payload = QmTimelineUndoPayload::fromJson(j);
+        QVERIFY(!payload.isNull());
+        QVERIFY(payload.json() == j);
+
+        QmTimelineUndoPayload empty;
+        QVERIFY(empty.isNull());
+        QVERIFY(empty.data().isEmpty());
+        QVERIFY(empty.json().is_null());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestQmTimelineUndoStore)
+#include "tst_qmtimelineundostore.moc"